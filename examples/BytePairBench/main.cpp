@@ -0,0 +1,193 @@
+// Speed of bytepair packer inner loops: plain C++ kernels against ones
+// selected for this CPU, and whole page packers. Data taken from code
+// and data segments of ELF files, as elf2e32 compresses them.
+// Results of both kernel sets compared too.
+//
+// Usage: BytePairBench <elf file>...
+// For example: BytePairBench ../../tests/libcrypto.dll ../../tests/AlternateReaderRecog.dll
+
+#include <chrono>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string.h>
+
+#include "elfdefs.h"
+#include "byte_pair.h"
+#include "cpu_features.h"
+#include "byte_pair_kernels.h"
+
+using namespace std;
+
+const int32_t PageSize = 0x1000;
+const int Rounds = 20;
+
+struct Segment
+{
+    string iName;
+    vector<uint8_t> iData;
+};
+
+vector<Segment> LoadSegments(const char* file)
+{
+    ifstream fs(file, ios::binary);
+    vector<uint8_t> elf((istreambuf_iterator<char>(fs)), istreambuf_iterator<char>());
+    vector<Segment> segments;
+    if(elf.size() < sizeof(Elf32_Ehdr) || memcmp(elf.data(), "\177ELF", 4))
+        return segments;
+    const Elf32_Ehdr* hdr = (const Elf32_Ehdr*)elf.data();
+    for(int i = 0; i < hdr->e_phnum; i++)
+    {
+        size_t pos = hdr->e_phoff + i * hdr->e_phentsize;
+        if(pos + sizeof(Elf32_Phdr) > elf.size())
+            break;
+        const Elf32_Phdr* ph = (const Elf32_Phdr*)&elf[pos];
+        if(ph->p_type != PT_LOAD || !ph->p_filesz || ph->p_offset + ph->p_filesz > elf.size())
+            continue;
+        Segment s;
+        s.iName = (ph->p_flags & PF_X) ? "code" : "data";
+        s.iData.assign(&elf[ph->p_offset], &elf[ph->p_offset] + ph->p_filesz);
+        segments.push_back(s);
+    }
+    return segments;
+}
+
+/// Input for PakReference() rounds: escaped page, marker, byte and pair it would take
+struct Page
+{
+    vector<uint8_t> iEscaped;
+    int32_t iMarker;
+    int32_t iByte;
+    int32_t iPair;
+};
+
+Page PreparePage(const uint8_t* data, int32_t size)
+{
+    uint16_t counts[0x100];
+    ScalarBytePairKernels().iHistogram(data, size, counts);
+    Page p;
+    p.iMarker = 0;
+    for(int32_t b = 1; b < 0x100; b++)
+        if(counts[b] < counts[p.iMarker])
+            p.iMarker = b;
+    p.iByte = (p.iMarker + 1) & 0xff;
+    p.iPair = (size > 1) ? (data[0] | (data[1] << 8)) : 0;
+    p.iEscaped.resize(size * 2);
+    p.iEscaped.resize(ScalarBytePairKernels().iEscape(p.iEscaped.data(), data, size, p.iMarker));
+    return p;
+}
+
+typedef void (*Job)(const BytePairKernels& k, const Segment& s, const vector<Page>& pages);
+
+void Histogram(const BytePairKernels& k, const Segment& s, const vector<Page>&)
+{
+    uint16_t counts[0x100];
+    for(size_t pos = 0; pos < s.iData.size(); pos += PageSize)
+        k.iHistogram(&s.iData[pos], min((size_t)PageSize, s.iData.size() - pos), counts);
+}
+
+void MarkBytes(const BytePairKernels& k, const Segment& s, const vector<Page>& pages)
+{
+    uint8_t state[PageSize];
+    for(size_t pos = 0, i = 0; pos < s.iData.size(); pos += PageSize, i++)
+        k.iMarkBytes(state, &s.iData[pos], min((size_t)PageSize, s.iData.size() - pos), pages[i].iMarker);
+}
+
+void Escape(const BytePairKernels& k, const Segment& s, const vector<Page>& pages)
+{
+    uint8_t out[PageSize * 2];
+    for(size_t pos = 0, i = 0; pos < s.iData.size(); pos += PageSize, i++)
+        k.iEscape(out, &s.iData[pos], min((size_t)PageSize, s.iData.size() - pos), pages[i].iMarker);
+}
+
+void Substitute(const BytePairKernels& k, const Segment&, const vector<Page>& pages)
+{
+    uint8_t out[PageSize * 2];
+    int32_t escaped, replaced;
+    for(auto& p: pages)
+        k.iSubstitute(out, p.iEscaped.data(), p.iEscaped.size(), p.iMarker, p.iByte, p.iPair, escaped, replaced);
+}
+
+double Speed(Job job, const BytePairKernels& k, const Segment& s, const vector<Page>& pages)
+{
+    auto start = chrono::steady_clock::now();
+    for(int r = 0; r < Rounds; r++)
+        job(k, s, pages);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return s.iData.size() * (double)Rounds / seconds / 1e6;
+}
+
+double PackerSpeed(int32_t (*pak)(uint8_t*, uint8_t*, int32_t), Segment& s)
+{
+    uint8_t out[PageSize * 4];
+    auto start = chrono::steady_clock::now();
+    for(size_t pos = 0; pos < s.iData.size(); pos += PageSize)
+        pak(out, &s.iData[pos], min((size_t)PageSize, s.iData.size() - pos));
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return s.iData.size() / seconds / 1e6;
+}
+
+/// Both kernel sets must give the same results
+bool Compare(const BytePairKernels& a, const BytePairKernels& b, const Segment& s, const vector<Page>& pages)
+{
+    for(size_t pos = 0, i = 0; pos < s.iData.size(); pos += PageSize, i++)
+    {
+        int32_t size = min((size_t)PageSize, s.iData.size() - pos);
+        const uint8_t* data = &s.iData[pos];
+        const Page& p = pages[i];
+        uint16_t ca[0x100], cb[0x100];
+        a.iHistogram(data, size, ca);
+        b.iHistogram(data, size, cb);
+        uint8_t sa[PageSize], sb[PageSize];
+        int32_t ma = a.iMarkBytes(sa, data, size, p.iMarker);
+        int32_t mb = b.iMarkBytes(sb, data, size, p.iMarker);
+        uint8_t ea[PageSize * 2], eb[PageSize * 2];
+        int32_t na = a.iEscape(ea, data, size, p.iMarker);
+        int32_t nb = b.iEscape(eb, data, size, p.iMarker);
+        int32_t xa, ya, xb, yb;
+        uint8_t ta[PageSize * 2], tb[PageSize * 2];
+        int32_t ra = a.iSubstitute(ta, p.iEscaped.data(), p.iEscaped.size(), p.iMarker, p.iByte, p.iPair, xa, ya);
+        int32_t rb = b.iSubstitute(tb, p.iEscaped.data(), p.iEscaped.size(), p.iMarker, p.iByte, p.iPair, xb, yb);
+        if(memcmp(ca, cb, sizeof(ca)) || (ma != mb) || (na != nb) || memcmp(ea, eb, na) ||
+            (ra != rb) || (xa != xb) || (ya != yb) || memcmp(ta, tb, ra))
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const BytePairKernels& scalar = ScalarBytePairKernels();
+    const BytePairKernels& best = GetBytePairKernels();
+    const CpuFeatures& cpu = GetCpuFeatures();
+    cout << "CPU: sse2 " << cpu.iSSE2 << ", sse4.1 " << cpu.iSSE41 << ", avx2 " << cpu.iAVX2
+         << ", pclmul " << cpu.iPCLMUL << "; kernels: " << best.iName << "\n";
+    cout << "MB/s, " << scalar.iName << " / " << best.iName << "\n";
+
+    const char* names[] = {"histogram", "mark", "escape", "substitute"};
+    Job jobs[] = {Histogram, MarkBytes, Escape, Substitute};
+    int failed = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        for(auto& s: LoadSegments(argv[i]))
+        {
+            vector<Page> pages;
+            for(size_t pos = 0; pos < s.iData.size(); pos += PageSize)
+                pages.push_back(PreparePage(&s.iData[pos], min((size_t)PageSize, s.iData.size() - pos)));
+            if(!Compare(scalar, best, s, pages))
+            {
+                cout << argv[i] << " " << s.iName << ": kernels results differ\n";
+                failed++;
+            }
+            cout << argv[i] << " " << s.iName << " (" << s.iData.size() << " bytes):";
+            for(int j = 0; j < 4; j++)
+                cout << " " << names[j] << " " << (int)Speed(jobs[j], scalar, s, pages)
+                     << " / " << (int)Speed(jobs[j], best, s, pages);
+            cout << ", PakReference() " << PackerSpeed(PakReference, s)
+                 << ", Pak() " << PackerSpeed(Pak, s) << "\n";
+        }
+    }
+    cout << (failed ? "Test failed!" : "All kernels match!") << endl;
+    return failed ? 1 : 0;
+}
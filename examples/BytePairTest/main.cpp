@@ -0,0 +1,64 @@
+// Check Pak() against original packer PakReference():
+// every 4 KB page of given files should pack to the same bytes and unpack back.
+//
+// Usage: BytePairTest <file>...
+// For example: BytePairTest ../../tests/*.dll ../../tests/*.exe
+
+#include <chrono>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string.h>
+
+#include "byte_pair.h"
+
+using namespace std;
+
+const int32_t PageSize = 0x1000;
+
+typedef int32_t (*Packer)(uint8_t* dst, uint8_t* src, int32_t size);
+
+double Measure(Packer pak, vector<uint8_t>& file)
+{
+    uint8_t out[PageSize * 4];
+    auto start = chrono::steady_clock::now();
+    for(size_t pos = 0; pos < file.size(); pos += PageSize)
+    {
+        int32_t size = min((size_t)PageSize, file.size() - pos);
+        pak(out, &file[pos], size);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        ifstream fs(argv[i], ios::binary);
+        vector<uint8_t> file((istreambuf_iterator<char>(fs)), istreambuf_iterator<char>());
+        for(size_t pos = 0; pos < file.size(); pos += PageSize)
+        {
+            int32_t size = min((size_t)PageSize, file.size() - pos);
+            uint8_t expected[PageSize * 4], packed[PageSize * 4], unpacked[PageSize];
+            int32_t expectedSize = PakReference(expected, &file[pos], size);
+            int32_t packedSize = Pak(packed, &file[pos], size);
+            uint8_t* next = nullptr;
+            int32_t unpackedSize = Unpak(unpacked, packed, packedSize, next);
+            if((packedSize != expectedSize) || memcmp(expected, packed, packedSize) ||
+                (unpackedSize != size) || memcmp(unpacked, &file[pos], size))
+            {
+                cout << argv[i] << ": page at " << pos << " differs\n";
+                failed++;
+            }
+        }
+
+        double reference = Measure(PakReference, file);
+        double current = Measure(Pak, file);
+        cout << argv[i] << ": " << file.size() << " bytes, PakReference() " << reference
+             << " s, Pak() " << current << " s\n";
+    }
+    cout << (failed ? "Test failed!" : "All pages match!") << endl;
+    return failed ? 1 : 0;
+}
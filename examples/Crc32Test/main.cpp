@@ -0,0 +1,100 @@
+// Check every CRC-32 engine against bit at a time CRC: buffers of all small
+// sizes and alignments, CRC continued by parts and joined by Crc32Combine(),
+// then compare speed on given files.
+//
+// Usage: Crc32Test <file>...
+// For example: Crc32Test ../../tests/*.dll ../../tests/*.exe
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "crc32.h"
+#include "e32common.h"
+
+using namespace std;
+
+uint32_t Reference(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0;
+    for(size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    return crc;
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+    mt19937 rng(1);
+    vector<uint8_t> buf(64 * 1024);
+    for(auto& x: buf)
+        x = rng();
+
+    for(auto e: Crc32Engines())
+    {
+        for(size_t size = 0; size < 600; size++)
+        {
+            for(size_t offset = 0; offset < 16; offset++)
+            {
+                if(e->iUpdate(0, &buf[offset], size) != Reference(&buf[offset], size))
+                {
+                    cout << e->iName << ": " << size << " bytes at " << offset << " differ\n";
+                    failed++;
+                }
+            }
+        }
+        if(e->iUpdate(0, buf.data(), buf.size()) != Reference(buf.data(), buf.size()))
+        {
+            cout << e->iName << ": whole buffer differs\n";
+            failed++;
+        }
+    }
+
+    for(int i = 0; i < 1000; i++)
+    {
+        size_t a = rng() % buf.size();
+        size_t b = rng() % (buf.size() - a);
+        uint32_t expected = Reference(buf.data(), a + b);
+        uint32_t crcA = Crc32(buf.data(), a);
+        uint32_t crcB = Crc32(&buf[a], b);
+        if((Crc32Update(crcA, &buf[a], b) != expected) || (Crc32Combine(crcA, crcB, b) != expected))
+        {
+            cout << "split at " << a << " of " << a + b << " bytes differs\n";
+            failed++;
+        }
+    }
+
+    cout << "Selected engine: " << GetCrc32Engine().iName << "\n";
+    for(int i = 1; i < argc; i++)
+    {
+        ifstream fs(argv[i], ios::binary);
+        vector<uint8_t> file((istreambuf_iterator<char>(fs)), istreambuf_iterator<char>());
+        uint32_t expected = Reference(file.data(), file.size());
+        cout << argv[i] << ": " << file.size() << " bytes";
+        for(auto e: Crc32Engines())
+        {
+            uint32_t crc = 0;
+            auto start = chrono::steady_clock::now();
+            for(int n = 0; n < 100; n++)
+                crc = e->iUpdate(0, file.data(), file.size());
+            double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << ", " << e->iName << " " << file.size() * 100 / time / 1e9 << " GB/s";
+            if(crc != expected)
+            {
+                cout << " (differs)";
+                failed++;
+            }
+        }
+        cout << "\n";
+    }
+
+    cout << (failed ? "Test failed!" : "All CRCs match!") << endl;
+    return failed ? 1 : 0;
+}
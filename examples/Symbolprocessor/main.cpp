@@ -20,6 +20,7 @@
 #include "symbol.h"
 #include "deffile.h"
 #include "elfparser.h"
+#include "symboltable.h"
 #include "elf2e32_opt.hpp"
 #include "symbolprocessor.h"
 
@@ -203,6 +204,8 @@ int main()
             break;
         try
         {
+            SymbolArena arena; // symbols of test freed with it
+            arena.Attach();
             tests[i]();
         }
         catch( ... )
@@ -0,0 +1,95 @@
+// Check SubstringMatcher against strstr() over Unwantedruntimesymbols:
+// every substring of every name, names with one changed character and
+// random strings should give the same answer, then compare speed.
+//
+// Usage: UnwantedSymbols
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <string.h>
+
+#include "staticlibsymbols.h"
+#include "substringmatcher.h"
+
+using namespace std;
+
+constexpr size_t KChars = WordsLength(Unwantedruntimesymbols);
+constexpr AutomatonSize KSize = SubstringAutomaton<KChars>(Unwantedruntimesymbols).Size();
+static constexpr SubstringMatcher<KChars, KSize.iStates, KSize.iEdges> Matcher(Unwantedruntimesymbols);
+
+bool Reference(const char* s)
+{
+    for(auto x: Unwantedruntimesymbols)
+    {
+        if(strstr(x, s))
+            return true;
+    }
+    return false;
+}
+
+int main()
+{
+    vector<string> samples;
+    for(string x: Unwantedruntimesymbols)
+    {
+        for(size_t pos = 0; pos < x.size(); pos++)
+        {
+            for(size_t len = 1; pos + len <= x.size(); len++)
+                samples.push_back(x.substr(pos, len));
+        }
+    }
+
+    mt19937 rng(1);
+    const string chars = "_$0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    for(string x: Unwantedruntimesymbols)
+    {
+        x[rng() % x.size()] = chars[rng() % chars.size()];
+        samples.push_back(x);
+        samples.push_back(x + chars[rng() % chars.size()]);
+        samples.push_back(chars[rng() % chars.size()] + x);
+    }
+    for(int i = 0; i < 100000; i++)
+    {
+        string x(1 + rng() % 12, ' ');
+        for(auto& c: x)
+            c = chars[rng() % chars.size()];
+        samples.push_back(x);
+    }
+    samples.push_back("");
+
+    int failed = 0;
+    size_t found = 0;
+    for(auto& x: samples)
+    {
+        bool expected = Reference(x.c_str());
+        found += expected;
+        if(Matcher.Contains(x.c_str()) != expected)
+        {
+            cout << "\"" << x << "\": expected " << expected << "\n";
+            failed++;
+        }
+    }
+    cout << samples.size() << " strings, " << found << " found, matcher takes "
+         << sizeof(Matcher) << " bytes\n";
+
+    // the same names as SymbolProcessor checks: whole symbols, mostly absent from list
+    vector<string> names(samples.end() - 100001, samples.end());
+    size_t hits[2] = {};
+    auto start = chrono::steady_clock::now();
+    for(auto& x: names)
+        hits[0] += Reference(x.c_str());
+    double reference = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    for(auto& x: names)
+        hits[1] += Matcher.Contains(x.c_str());
+    double current = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << names.size() << " names: strstr() " << reference << " s, SubstringMatcher " << current << " s\n";
+
+    if(hits[0] != hits[1])
+        failed++;
+    cout << (failed ? "Test failed!" : "All strings match!") << endl;
+    return failed ? 1 : 0;
+}
@@ -80,6 +80,13 @@ struct OptionsType
         EMANDSODUMP,
         EMANARTIFACTS,
         EHELP,
+        EBATCH,
+        EJOBS,
+        ESERVE,
+        ECONNECT,
+        ECACHE,
+        EPROFILE,
+        EREPACK,
         // internal
         EARGWAITING,
         // dev options
@@ -87,6 +94,7 @@ struct OptionsType
         TIME,
         VERBOSE,
         FORCEE32BUILD,
+        STRICTVALIDATION,
         // ignored
         EMESSAGEFILE,
         EDUMPMESSAGEFILE,
@@ -121,9 +129,11 @@ struct Args
     TargetType iTargettype = TargetType::EInvalidTargetType;
     std::string iLinkas;
     uint32_t iCompressionMethod = KUidCompressionDeflate;
+    bool iCompressionSet = false; // --compressionmethod or --uncompressed used
     bool iUnfrozen = false;
     bool iIgnorenoncallable = false;
     std::string iCapability = "NONE";
+    bool iCapabilitySet = false; // --capability used, E32Rebuilder keeps caps otherwise
     std::string iSysdef;
     bool iNoDlldata = true; //on by default
     uint16_t iPriority = (uint16_t)TProcessPriority::EPriorityForeground; // executables priority
@@ -140,11 +150,20 @@ struct Args
     std::string iE32input;
     std::string iDump = "h";
     std::string iLog;
+    std::string iBatch; // manifest with argument set per line
+    uint32_t iJobs = 0; // worker threads for --batch and --repack and size of shared pool, 0 - use all cores
+    std::string iServe; // socket for daemon
+    std::string iConnect; // socket of daemon to run job
+    std::vector<std::string> iDaemonArgs; // options after --connect
+    std::string iCache; // directory of build cache
+    std::string iProfile; // file for phase timings and counters
+    std::string iRepack; // directory or glob of E32Images to repack
     uint32_t iVersion = 0x000a0000u; // ex: elf2e32.exe --version
     std::string iHeader;
     uint32_t iTime[2] = {0};
     std::vector<std::string> iFileCrc;
     bool iForceE32Build = false;
+    bool iStrictValidation = false; // decode compressed E32Image in full
 };
 
 #endif // ELF2E32_OPT_HPP_INCLUDED
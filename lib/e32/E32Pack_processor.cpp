@@ -16,7 +16,11 @@
 //
 
 #include <ios>
+#include <string.h>
+#include <algorithm>
 #include "common.hpp"
+#include "inflate.h"
+#include "byte_pair.h"
 #include "e32common.h"
 #include "e32compressor.h"
 
@@ -71,6 +75,8 @@ E32Buf CompressE32Image(const E32Buf& source)
 
     if(h->iCompressionType == KUidCompressionBytePair)
     {
+        // incompressible page grows by byte, every page takes 2 bytes in index table
+        compressed.resize(source.size() + (source.size() / 4096 + 2) * 3 + 64);
         int32_t BPECodeSize = CompressBPE(&source[offset], h->iCodeSize, &compressed[offset], source.size() - offset);
         int32_t srcOffset = offset + h->iCodeSize;
         int32_t BPEDataSize = CompressBPE(nullptr, source.size() - srcOffset,
@@ -87,6 +93,162 @@ E32Buf CompressE32Image(const E32Buf& source)
     return compressed;
 }
 
+const uint32_t KPageSize = 4096;
+
+E32ImageView::E32ImageView(const char* source, size_t size):
+    iSource(source), iSourceSize(size)
+{
+    const E32ImageHeader* h = (const E32ImageHeader*)source;
+    const E32ImageHeaderJ* j = (const E32ImageHeaderJ*)(source + sizeof(E32ImageHeader));
+    const uint32_t offset = h->iCodeOffset;
+    const uint32_t extracted = j->iUncompressedSize;
+    size_t e32Size = Adjust(extracted + offset);
+
+    if(e32Size != (extracted + offset))
+        ReportError(ErrorCodes::WRONGFILESIZEFORDECOMPRESSION,
+            extracted + offset, e32Size);
+    if(offset > size)
+        ReportError(ErrorCodes::WRONGFILESIZEFORDECOMPRESSION, size, offset);
+    iImage.reserve(offset + e32Size);
+    iImage.insert(iImage.end(), source, source + offset);
+    iImage.insert(iImage.end(), e32Size, '0');
+    iDataEnd = offset + extracted;
+
+    if(h->iCompressionType == KUidCompressionBytePair)
+    {
+        size_t pos = IndexPages(offset, offset);
+        size_t uncompressedCodeSize = iPages.empty() ? 0 : (iPages.back().iOffset + iPages.back().iSize - offset);
+        if(pos < size)
+            IndexPages(pos, offset + uncompressedCodeSize);
+        size_t uncompressed = iPages.empty() ? 0 : (iPages.back().iOffset + iPages.back().iSize - offset);
+        if(uncompressed != extracted)
+            ReportWarning(ErrorCodes::BYTEPAIRINCONSISTENTSIZE);
+    }else if(h->iCompressionType == KUidCompressionDeflate)
+    {
+        iInput = new TFileInput((unsigned char*)source + offset, size - offset);
+        iInflater = CInflater::NewLC(*iInput);
+        iInflated = offset;
+    }else
+        ReportError(ErrorCodes::UNKNOWNCOMPRESSION);
+}
+
+E32ImageView::~E32ImageView()
+{
+    delete iInflater;
+    delete iInput;
+}
+
+/// Read page table of bytepair part at pos in source, pages placed at offset in image
+size_t E32ImageView::IndexPages(size_t pos, size_t offset)
+{
+    if(pos + sizeof(IndexTableHeader) > iSourceSize)
+        ReportError(ErrorCodes::BYTEPAIRINCONSISTENTSIZE);
+    const IndexTableHeader* h = (const IndexTableHeader*)(iSource + pos);
+    size_t end = pos + h->iSizeOfData;
+    size_t packed = pos + sizeof(IndexTableHeader) + h->iNumberOfPages * sizeof(uint16_t);
+    if((h->iSizeOfData < 0) || (h->iDecompressedSize < 0) || (end > iSourceSize) || (packed > end) ||
+        (offset + h->iDecompressedSize > iImage.size()) ||
+        ((size_t)h->iNumberOfPages * KPageSize < (size_t)h->iDecompressedSize))
+        ReportError(ErrorCodes::BYTEPAIRINCONSISTENTSIZE);
+
+    const uint16_t* pageIndexTable = (const uint16_t*)(iSource + pos + sizeof(IndexTableHeader));
+    uint32_t left = h->iDecompressedSize;
+    for(uint32_t i = 0; i < h->iNumberOfPages; i++)
+    {
+        Page p;
+        p.iOffset = offset + i * KPageSize;
+        p.iSize = left > KPageSize ? KPageSize : left;
+        p.iPacked = packed;
+        p.iPackedSize = pageIndexTable[i];
+        packed += p.iPackedSize;
+        left -= p.iSize;
+        if(packed > end)
+            ReportError(ErrorCodes::BYTEPAIRINCONSISTENTSIZE);
+        iPages.push_back(p);
+    }
+    return end;
+}
+
+void E32ImageView::DecodePage(size_t page)
+{
+    Page& p = iPages[page];
+    if(p.iDecoded)
+        return;
+    uint8_t buf[KPageSize];
+    uint8_t* next = nullptr;
+    int32_t size = Unpak(buf, (uint8_t*)iSource + p.iPacked, p.iPackedSize, next);
+    if((size != (int32_t)p.iSize) && !iWarned)
+    {
+        ReportWarning(ErrorCodes::BYTEPAIRINCONSISTENTSIZE);
+        iWarned = true;
+    }
+    if(size > 0)
+        memcpy(&iImage[p.iOffset], buf, std::min((uint32_t)size, p.iSize));
+    p.iDecoded = true;
+}
+
+void E32ImageView::Decode(size_t offset, size_t size)
+{
+    if((offset >= iDataEnd) || !size)
+        return;
+    size_t end = (size > iDataEnd - offset) ? iDataEnd : (offset + size);
+
+    if(iInflater)
+    {
+        if(end > iInflated)
+        {
+            iInflated += iInflater->ReadL((uint8_t*)&iImage[iInflated], end - iInflated);
+            if(iInflated < end) // stream ended, nothing to wait for
+                iInflated = iDataEnd;
+        }
+        return;
+    }
+
+    auto first = std::upper_bound(iPages.begin(), iPages.end(), offset,
+        [](size_t x, const Page& p){return x < p.iOffset + p.iSize;});
+    for(auto i = first; (i != iPages.end()) && (i->iOffset < end); i++)
+        DecodePage(i - iPages.begin());
+}
+
+const uint32_t KVerifyPageStep = 16;
+
+/// Image just compressed from source already validated, so check only codec.
+/// Without full check bytepair unpacks every KVerifyPageStep page and last pages
+/// of code and data. Deflate stream can't be unpacked from the middle, so it
+/// decoded in full anyway: inflate takes small part of deflate time.
+void VerifyE32Compression(const char* source, size_t sourceSize, const E32Buf& compressed, bool full)
+{
+    const E32ImageHeader* h = (const E32ImageHeader*)source;
+    const uint32_t offset = h->iCodeOffset;
+    if((compressed.size() < offset) || memcmp(source, &compressed[0], offset))
+        ReportError(ErrorCodes::COMPRESSIONMISMATCH, "header");
+    if(h->iCompressionType == KFormatNotCompressed)
+    {
+        if((compressed.size() != sourceSize) || memcmp(source, &compressed[0], sourceSize))
+            ReportError(ErrorCodes::COMPRESSIONMISMATCH, "image");
+        return;
+    }
+
+    if(full || (h->iCompressionType != KUidCompressionBytePair))
+    {
+        E32Buf buf = DeCompressE32Image(compressed); // has padding after image
+        if((buf.size() < sourceSize) || memcmp(source, &buf[0], sourceSize))
+            ReportError(ErrorCodes::COMPRESSIONMISMATCH, "image");
+        return;
+    }
+
+    uint32_t codeSize = h->iCodeSize;
+    uint32_t used = 0;
+    if(!VerifyBPE(&compressed[offset], compressed.size() - offset, source + offset,
+                  codeSize, KVerifyPageStep, used))
+        ReportError(ErrorCodes::COMPRESSIONMISMATCH, "code pages");
+    uint32_t pos = offset + used;
+    if(!VerifyBPE(&compressed[0] + pos, compressed.size() - pos, source + offset + codeSize,
+                  sourceSize - offset - codeSize, KVerifyPageStep, used) ||
+        (pos + used != compressed.size()))
+        ReportError(ErrorCodes::COMPRESSIONMISMATCH, "data pages");
+}
+
 int32_t Adjust(int32_t size)
 {
     return ((size+0x3)&0xfffffffc);
@@ -15,9 +15,12 @@
 //
 //
 
+#include <vector>
 #include <cstdint>
+#include <string.h>
 
 #include "byte_pair.h"
+#include "workerpool.h"
 #include "e32compressor.h"
 
 #define PAGE_SIZE 4096
@@ -43,16 +46,7 @@
    IndexTableHeader::iSizeOfData - sizeof(IndexTableHeader) - IndexTableHeader::iNumberOfPages * sizeof(uint16_t)
  Every page compressed separately. It size after compression stored in Page index table
  ***********************************************/
-#pragma pack(push, 1)
-struct IndexTableHeader
-{
-    int32_t	iSizeOfData;		// Includes the index and compressed pages
-    int32_t	iDecompressedSize;
-    uint16_t   iNumberOfPages;
-};
-#pragma pack(pop)
-
-static uint8_t* BPEBlock = nullptr;
+static thread_local uint8_t* BPEBlock = nullptr;
 uint32_t DecompressBPE(const char* src, char* dst)
 {
     if(!BPEBlock && !src)
@@ -79,8 +73,69 @@ uint32_t DecompressBPE(const char* src, char* dst)
     return sz;
 }
 
-static uint8_t* inBlock = nullptr;
-static uint8_t* outBlock = nullptr;
+/// Pages unpacked independently, so check can skip some of them: unpack
+/// every step page and the last one and compare with src. Gets size of block.
+bool VerifyBPE(const char* block, uint32_t blockSize, const char* src, uint32_t srcSize,
+               uint32_t step, uint32_t& used)
+{
+    used = 0;
+    if(!srcSize) // CompressBPE() writes nothing for empty part
+        return true;
+    if(blockSize < sizeof(IndexTableHeader))
+        return false;
+
+    const IndexTableHeader* h = (const IndexTableHeader*)block;
+    uint32_t numOfPages = (srcSize + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t pos = sizeof(IndexTableHeader) + numOfPages * sizeof(uint16_t);
+    if((h->iDecompressedSize != (int32_t)srcSize) || (h->iNumberOfPages != numOfPages) ||
+        (h->iSizeOfData < (int32_t)pos) || ((uint32_t)h->iSizeOfData > blockSize))
+        return false;
+
+    const uint16_t* pageIndexTable = (const uint16_t*)(block + sizeof(IndexTableHeader));
+    uint8_t page[PAGE_SIZE];
+    for(uint32_t i = 0; i < numOfPages; i++)
+    {
+        uint32_t compressedSize = pageIndexTable[i];
+        if(pos + compressedSize > (uint32_t)h->iSizeOfData)
+            return false;
+        if((i % step == 0) || (i == numOfPages - 1))
+        {
+            uint32_t offset = i * PAGE_SIZE;
+            uint32_t size = (srcSize - offset) > PAGE_SIZE ? PAGE_SIZE : (srcSize - offset);
+            uint8_t* next = nullptr;
+            int32_t unpacked = Unpak(page, (uint8_t*)block + pos, compressedSize, next);
+            if((unpacked != (int32_t)size) || memcmp(page, src + offset, size))
+                return false;
+        }
+        pos += compressedSize;
+    }
+    used = pos;
+    return pos == (uint32_t)h->iSizeOfData;
+}
+
+typedef std::vector<uint8_t> PakedPage;
+
+// few pages packed faster than handed to pool
+const uint32_t KMinParallelPages = 4;
+
+/// Pages compressed independently, so pool threads pack them to own buffers
+/// and caller stores them in page order. Result same as for sequental Pak() calls.
+std::vector<PakedPage> PakPages(uint8_t* src, uint32_t srcSize, uint16_t numOfPages)
+{
+    std::vector<PakedPage> pages(numOfPages);
+    ParallelFor(numOfPages, KMinParallelPages, [&](uint32_t i)
+    {
+        uint8_t scratch[PAGE_SIZE * 4]; // Pak() uses output as work buffer
+        uint32_t offset = i * PAGE_SIZE;
+        uint32_t size = (srcSize - offset) > PAGE_SIZE ? PAGE_SIZE : (srcSize - offset);
+        int32_t compressedSize = Pak(scratch, src + offset, size);
+        pages[i].assign(scratch, scratch + compressedSize);
+    });
+    return pages;
+}
+
+static thread_local uint8_t* inBlock = nullptr;
+static thread_local uint8_t* outBlock = nullptr;
 uint32_t CompressBPE(const char* src, const uint32_t srcSize, char* dst, uint32_t dstSize)
 {
     if(src)
@@ -103,20 +158,18 @@ uint32_t CompressBPE(const char* src, const uint32_t srcSize, char* dst, uint32_
     indexHdr->iDecompressedSize = srcSize;
     indexHdr->iSizeOfData = sizeof(IndexTableHeader) + numOfPages * sizeof(uint16_t);
 
-    uint32_t remain = srcSize;
+    std::vector<PakedPage> pages = PakPages(inBlock, srcSize, numOfPages);
     for(uint32_t i = 0; i < numOfPages; i++)
     {
-        uint32_t offset = remain > PAGE_SIZE ? PAGE_SIZE : remain;
-        uint16_t compressedSize = (uint16_t)Pak(pagesOut, inBlock, offset);
+        uint16_t compressedSize = (uint16_t)pages[i].size();
         pageIndexTable[i] = compressedSize;
 
         indexHdr->iSizeOfData += compressedSize;
+        memcpy(pagesOut, pages[i].data(), compressedSize);
         pagesOut += compressedSize;
-        inBlock += offset;
-        remain -= offset;
     }
+    inBlock += srcSize;
     outBlock = pagesOut;
 
     return indexHdr->iSizeOfData;
 }
-
@@ -14,27 +14,30 @@
 // Description:
 //
 
+#include <memory>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 #include "byte_pair.h"
 #include "e32common.h"
+#include "byte_pair_kernels.h"
 
 const int32_t MaxBlockSize = 0x1000;
 
-uint16_t PairCount[0x10000];
-uint16_t PairBuffer[MaxBlockSize*2];
+// Work buffers are per thread: batch jobs compress images concurrently.
+// Static ones accessed directly, without TLS wrapper call.
+static thread_local uint16_t PairCount[0x10000];
+static thread_local uint16_t PairBuffer[MaxBlockSize*2];
 
-uint16_t GlobalPairs[0x10000] = {0};
-uint16_t GlobalTokenCounts[0x100] = {0};
+static thread_local uint16_t GlobalPairs[0x10000] = {0};
+static thread_local uint16_t GlobalTokenCounts[0x100] = {0};
 
-uint16_t ByteCount[0x100+4];
+static thread_local uint16_t ByteCount[0x100+4];
 
 void CountBytes(uint8_t* data, int32_t size)
 	{
 	memset(ByteCount,0,sizeof(ByteCount));
-	uint8_t* dataEnd = data+size;
-	while(data<dataEnd)
-		++ByteCount[*data++];
+	GetBytePairKernels().iHistogram(data,size,ByteCount);
 	}
 
 
@@ -152,7 +155,56 @@ int32_t LeastCommonByte(int32_t& byte)
 }
 
 
-int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
+void SortTokens(uint8_t* tokens, int32_t tokenCount)
+{
+	for(int32_t x=0; x<tokenCount-1; x++)
+		for(int32_t y=x+1; y<tokenCount; y++)
+			if(tokens[x*3]>tokens[y*3])
+            {
+				int32_t z = tokens[x*3];
+				tokens[x*3] = tokens[y*3];
+				tokens[y*3] = (uint8_t)z;
+				z = tokens[x*3+1];
+				tokens[x*3+1] = tokens[y*3+1];
+				tokens[y*3+1] = (uint8_t)z;
+				z = tokens[x*3+2];
+				tokens[x*3+2] = tokens[y*3+2];
+				tokens[y*3+2] = (uint8_t)z;
+            }
+}
+
+uint8_t* StoreTokens(uint8_t* dst, uint8_t* tokens, int32_t tokenCount, int32_t marker)
+{
+	*dst++ = (uint8_t)tokenCount;
+	if(tokenCount)
+    {
+		*dst++ = (uint8_t)marker;
+		if(tokenCount<32)
+        {
+			memcpy(dst,tokens,tokenCount*3);
+			dst += tokenCount*3;
+        }
+		else
+        {
+			uint8_t* bitMask = dst;
+			memset(bitMask,0,32);
+			dst += 32;
+			uint8_t* d=tokens;
+			do
+				{
+				int32_t t=*d++;
+				bitMask[t>>3] |= (1<<(t&7));
+				*dst++ = *d++;
+				*dst++ = *d++;
+				}
+			while(--tokenCount);
+        }
+    }
+	return dst;
+}
+
+
+int32_t PakReference(uint8_t* dst, uint8_t* src, int32_t size)
 {
 	int32_t originalSize = size;
 	uint8_t* dst2 = dst+size*2;
@@ -168,16 +220,8 @@ int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
 	int32_t overhead = 1+3+LeastCommonByte(marker);
 	ByteUsed(marker);
 
-	uint8_t* inEnd = in+size;
-	uint8_t* outStart = out;
-	while(in<inEnd)
-    {
-		int32_t b=*in++;
-		if(b==marker)
-			*out++ = (uint8_t)b;
-		*out++ = (uint8_t)b;
-    }
-	size = out-outStart;
+	const BytePairKernels& kernels = GetBytePairKernels();
+	size = kernels.iEscape(out,in,size,marker);
 
 	int32_t outToggle = 1;
 	in = dst;
@@ -207,32 +251,12 @@ int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
 		ByteUsed(pair>>8);
 		++GlobalPairs[pair];
 
-		inEnd = in+size;
-		outStart = out;
-		while(in<inEnd)
-        {
-			int32_t b=*in++;
-			if(b==marker)
-            {
-				*out++ = (uint8_t)marker;
-				b = *in++;
-            }
-			else if(b==byte)
-            {
-				*out++ = (uint8_t)marker;
-				--byteCount;
-            }
-			else if(b==(pair&0xff) && in<inEnd && *in==(pair>>8))
-            {
-				++in;
-				b = byte;
-				--pairCount;
-            }
-			*out++ = (uint8_t)b;
-        }
+		int32_t escaped, replaced;
+		size = kernels.iSubstitute(out,in,size,marker,byte,pair,escaped,replaced);
+		byteCount -= escaped;
+		pairCount -= replaced;
 		assert(!byteCount);
 		assert(!pairCount);
-		size = out-outStart;
 
 		outToggle ^= 1;
 		if(outToggle)
@@ -248,20 +272,7 @@ int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
     }
 
 	// sort tokens with a bubble sort...
-	for(int32_t x=0; x<tokenCount-1; x++)
-		for(int32_t y=x+1; y<tokenCount; y++)
-			if(tokens[x*3]>tokens[y*3])
-            {
-				int32_t z = tokens[x*3];
-				tokens[x*3] = tokens[y*3];
-				tokens[y*3] = (uint8_t)z;
-				z = tokens[x*3+1];
-				tokens[x*3+1] = tokens[y*3+1];
-				tokens[y*3+1] = (uint8_t)z;
-				z = tokens[x*3+2];
-				tokens[x*3+2] = tokens[y*3+2];
-				tokens[y*3+2] = (uint8_t)z;
-            }
+	SortTokens(tokens,tokenCount);
 
 	// check for not being able to compress...
 	if(size>originalSize)
@@ -277,31 +288,8 @@ int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
 
 	// store tokens...
 	uint8_t* originalDst = dst;
-	*dst++ = (uint8_t)tokenCount;
-	if(tokenCount)
-    {
-		*dst++ = (uint8_t)marker;
-		if(tokenCount<32)
-        {
-			memcpy(dst,tokens,tokenCount*3);
-			dst += tokenCount*3;
-        }
-		else
-        {
-			uint8_t* bitMask = dst;
-			memset(bitMask,0,32);
-			dst += 32;
-			uint8_t* d=tokens;
-			do
-				{
-				int32_t t=*d++;
-				bitMask[t>>3] |= (1<<(t&7));
-				*dst++ = *d++;
-				*dst++ = *d++;
-				}
-			while(--tokenCount);
-        }
-    }
+	dst = StoreTokens(dst,tokens,tokenCount,marker);
+
 	// store data...
 	memcpy(dst,dst2,size);
 	dst += size;
@@ -314,6 +302,500 @@ int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
 }
 
 
+// Pair statistics for Pak(), updated only around replaced positions.
+//
+// Data kept as list of nodes, one node per source byte. Escaped node written
+// as marker and its value. Counters follow MostCommonPair() rules: pairs with
+// escaped node skipped, pair of identical bytes counted once per two bytes
+// of run. Run length kept at both ends of run, so shorten or grow run
+// at its end costs nothing.
+//
+// Pairs with equal frequency and TieBreak() chosen as MostCommonPair() does:
+// which pair earlier reached minimal frequency in data.
+class TPairIndex
+	{
+public:
+	TPairIndex();
+	void Build(const uint8_t* src, int32_t size, int32_t marker);
+	int32_t MostCommonPair(int32_t& pair, int32_t minFrequency);
+	int32_t Escape(int32_t byte);
+	int32_t Replace(int32_t pair, int32_t byte);
+	int32_t Size() const {return iSize;}
+	void Write(uint8_t* dst) const;
+private:
+	enum TState {EPlain, EEscaped, EDeleted};
+	inline bool IsPlain(int32_t n) const
+		{
+		return n>=0 && iState[n]==EPlain;
+		}
+	inline int32_t PairAt(int32_t n) const
+		{
+		return (iValue[iNext[n]]<<8)|iValue[n];
+		}
+	inline void Touch(int32_t p);
+	void AddCount(int32_t p, int32_t delta);
+	void LinkPair(int32_t n);
+	void UnlinkPair(int32_t n);
+	int32_t CollectPairs(int32_t p);
+	int32_t NthOccurrence(int32_t p, int32_t nth);
+	void ReplaceAt(int32_t n, int32_t byte);
+	void SetRun(int32_t head, int32_t tail, int32_t length);
+private:
+	int32_t iHead = -1;
+	int32_t iSize = 0;
+	int32_t iMarker = -1;
+	int32_t iMaxCount = 0;
+	uint32_t iEpoch = 0;
+
+	// nodes
+	uint8_t iValue[MaxBlockSize];
+	uint8_t iState[MaxBlockSize];
+	int16_t iNext[MaxBlockSize];
+	int16_t iPrev[MaxBlockSize];
+	int16_t iRunOther[MaxBlockSize]; // other end of run, valid at ends only
+	uint16_t iRunLength[MaxBlockSize];
+	int16_t iPairNext[MaxBlockSize]; // nodes starting same pair
+	int16_t iPairPrev[MaxBlockSize];
+	int16_t iByValue[MaxBlockSize]; // nodes sorted by value
+	int16_t iByValueStart[0x101];
+	int16_t iScratch[MaxBlockSize];
+
+	// pairs, valid if iPairEpoch[p]==iEpoch
+	uint32_t iPairEpoch[0x10000];
+	uint16_t iCount[0x10000];
+	int16_t iPairHead[0x10000];
+	int32_t iBucketNext[0x10000]; // pairs with same count
+	int32_t iBucketPrev[0x10000];
+	int32_t iBucketHead[MaxBlockSize+1];
+	};
+
+TPairIndex::TPairIndex()
+	{
+	memset(iPairEpoch,0,sizeof(iPairEpoch));
+	}
+
+inline void TPairIndex::Touch(int32_t p)
+	{
+	if(iPairEpoch[p]==iEpoch)
+		return;
+	iPairEpoch[p] = iEpoch;
+	iCount[p] = 0;
+	iPairHead[p] = -1;
+	}
+
+void TPairIndex::AddCount(int32_t p, int32_t delta)
+	{
+	if(!delta)
+		return;
+	Touch(p);
+	int32_t c = iCount[p];
+	if(c)
+		{
+		if(iBucketPrev[p]>=0)
+			iBucketNext[iBucketPrev[p]] = iBucketNext[p];
+		else
+			iBucketHead[c] = iBucketNext[p];
+		if(iBucketNext[p]>=0)
+			iBucketPrev[iBucketNext[p]] = iBucketPrev[p];
+		}
+	c += delta;
+	assert(c>=0);
+	iCount[p] = (uint16_t)c;
+	if(c)
+		{
+		iBucketPrev[p] = -1;
+		iBucketNext[p] = iBucketHead[c];
+		if(iBucketHead[c]>=0)
+			iBucketPrev[iBucketHead[c]] = p;
+		iBucketHead[c] = p;
+		if(c>iMaxCount)
+			iMaxCount = c;
+		}
+	}
+
+// node n and next one are plain
+void TPairIndex::LinkPair(int32_t n)
+	{
+	int32_t p = PairAt(n);
+	Touch(p);
+	iPairPrev[n] = -1;
+	iPairNext[n] = iPairHead[p];
+	if(iPairHead[p]>=0)
+		iPairPrev[iPairHead[p]] = (int16_t)n;
+	iPairHead[p] = (int16_t)n;
+	}
+
+void TPairIndex::UnlinkPair(int32_t n)
+	{
+	if(iPairPrev[n]>=0)
+		iPairNext[iPairPrev[n]] = iPairNext[n];
+	else
+		iPairHead[PairAt(n)] = iPairNext[n];
+	if(iPairNext[n]>=0)
+		iPairPrev[iPairNext[n]] = iPairPrev[n];
+	}
+
+void TPairIndex::SetRun(int32_t head, int32_t tail, int32_t length)
+	{
+	iRunOther[head] = (int16_t)tail;
+	iRunOther[tail] = (int16_t)head;
+	iRunLength[head] = (uint16_t)length;
+	iRunLength[tail] = (uint16_t)length;
+	}
+
+void TPairIndex::Build(const uint8_t* src, int32_t size, int32_t marker)
+	{
+	if(++iEpoch==0) // wrapped, forget all
+		{
+		memset(iPairEpoch,0,sizeof(iPairEpoch));
+		iEpoch = 1;
+		}
+	memset(iBucketHead,-1,sizeof(iBucketHead));
+	iMaxCount = 0;
+	iMarker = marker;
+	iHead = size ? 0 : -1;
+	iSize = size;
+
+	const BytePairKernels& kernels = GetBytePairKernels();
+	memcpy(iValue,src,size);
+	iSize += kernels.iMarkBytes(iState,src,size,marker); // EPlain is 0, EEscaped is 1
+	int32_t n;
+	for(n=0; n<size; n++)
+		{
+		iNext[n] = (int16_t)((n+1<size) ? n+1 : -1);
+		iPrev[n] = (int16_t)(n-1);
+		}
+
+	n = 0;
+	while(n<size)
+		{
+		if(!IsPlain(n))
+			{
+			++n;
+			continue;
+			}
+		int32_t tail = n;
+		while(IsPlain(iNext[tail]) && iValue[iNext[tail]]==iValue[n])
+			{
+			LinkPair(tail);
+			tail = iNext[tail];
+			}
+		int32_t length = tail-n+1;
+		SetRun(n,tail,length);
+		AddCount((iValue[n]<<8)|iValue[n],length/2);
+		if(IsPlain(iNext[tail]))
+			{
+			LinkPair(tail);
+			AddCount(PairAt(tail),1);
+			}
+		n = tail+1;
+		}
+
+	uint16_t counts[0x100];
+	kernels.iHistogram(src,size,counts);
+	int16_t start[0x101] = {0};
+	for(n=0; n<0x100; n++)
+		start[n+1] = (int16_t)(start[n]+counts[n]);
+	memcpy(iByValueStart,start,sizeof(start));
+	for(n=0; n<size; n++)
+		iByValue[start[src[n]]++] = (int16_t)n;
+	}
+
+// nodes where pair p starts, in data order
+int32_t TPairIndex::CollectPairs(int32_t p)
+	{
+	Touch(p);
+	int32_t count = 0;
+	for(int32_t n=iPairHead[p]; n>=0; n=iPairNext[n])
+		iScratch[count++] = (int16_t)n;
+	std::sort(iScratch,iScratch+count);
+	return count;
+	}
+
+// where MostCommonPair() counts pair p nth time
+int32_t TPairIndex::NthOccurrence(int32_t p, int32_t nth)
+	{
+	int32_t count = CollectPairs(p);
+	int32_t last = -1;
+	for(int32_t i=0; i<count; i++)
+		{
+		int32_t n = iScratch[i];
+		if(n==last) // second pair of identical bytes in row
+			{
+			last = -1;
+			continue;
+			}
+		last = iNext[n];
+		if(!--nth)
+			return n;
+		}
+	assert(0);
+	return -1;
+	}
+
+int32_t TPairIndex::MostCommonPair(int32_t& pair, int32_t minFrequency)
+	{
+	while(iMaxCount>0 && iBucketHead[iMaxCount]<0)
+		--iMaxCount;
+	pair = -1;
+	if(!iMaxCount || iMaxCount<minFrequency)
+		return -1;
+
+	int32_t bestTieBreak = 0;
+	int32_t ties = 0;
+	for(int32_t p=iBucketHead[iMaxCount]; p>=0; p=iBucketNext[p])
+		{
+		int32_t tieBreak = TieBreak(p&0xff,p>>8);
+		if(pair<0 || tieBreak>bestTieBreak)
+			{
+			pair = p;
+			bestTieBreak = tieBreak;
+			ties = 0;
+			}
+		else if(tieBreak==bestTieBreak)
+			++ties;
+		}
+	if(ties)
+		{
+		int32_t bestPlace = -1;
+		for(int32_t p=iBucketHead[iMaxCount]; p>=0; p=iBucketNext[p])
+			{
+			if(TieBreak(p&0xff,p>>8)!=bestTieBreak)
+				continue;
+			int32_t place = NthOccurrence(p,minFrequency);
+			if(place>bestPlace)
+				{
+				bestPlace = place;
+				pair = p;
+				}
+			}
+		}
+	return iMaxCount;
+	}
+
+// all plain nodes with value byte become escaped
+int32_t TPairIndex::Escape(int32_t byte)
+	{
+	int32_t escaped = 0;
+	for(int32_t i=iByValueStart[byte]; i<iByValueStart[byte+1]; i++)
+		{
+		int32_t head = iByValue[i];
+		if(!IsPlain(head))
+			continue;
+		int32_t tail = iRunOther[head];
+		int32_t length = iRunLength[head];
+		int32_t prev = iPrev[head];
+		int32_t next = iNext[tail];
+		if(IsPlain(prev))
+			{
+			UnlinkPair(prev);
+			AddCount(PairAt(prev),-1);
+			}
+		if(IsPlain(next))
+			{
+			UnlinkPair(tail);
+			AddCount(PairAt(tail),-1);
+			}
+		AddCount((byte<<8)|byte,-(length/2));
+		for(int32_t n=head; ; n=iNext[n])
+			{
+			if(n!=tail)
+				UnlinkPair(n);
+			iState[n] = EEscaped;
+			if(n==tail)
+				break;
+			}
+		escaped += length;
+		}
+	iSize += escaped;
+	return escaped;
+	}
+
+int32_t TPairIndex::Replace(int32_t pair, int32_t byte)
+	{
+	int32_t b1 = pair&0xff;
+	int32_t b2 = pair>>8;
+	int32_t count = CollectPairs(pair);
+	int32_t replaced = 0;
+	for(int32_t i=0; i<count; i++)
+		{
+		int32_t n = iScratch[i];
+		// pair of identical bytes may be gone with previous one
+		if(!IsPlain(n) || !IsPlain(iNext[n]) || iValue[n]!=b1 || iValue[iNext[n]]!=b2)
+			continue;
+		ReplaceAt(n,byte);
+		++replaced;
+		}
+	iSize -= replaced;
+	return replaced;
+	}
+
+// Replace pair at node n and next one with byte. Pair of different bytes
+// ends run of first byte and starts run of second one, pair of identical
+// bytes always starts run.
+void TPairIndex::ReplaceAt(int32_t n, int32_t byte)
+	{
+	int32_t b1 = iValue[n];
+	int32_t next = iNext[n];
+	int32_t b2 = iValue[next];
+	int32_t prev = iPrev[n];
+	int32_t after = iNext[next];
+	bool prevPlain = IsPlain(prev);
+	bool afterPlain = IsPlain(after);
+
+	if(prevPlain)
+		UnlinkPair(prev);
+	UnlinkPair(n);
+	if(afterPlain)
+		UnlinkPair(next);
+
+	if(b1!=b2)
+		{
+		int32_t head = iRunOther[n];
+		int32_t length = iRunLength[n];
+		if(length>1)
+			{
+			AddCount((b1<<8)|b1,(length-1)/2-length/2);
+			SetRun(head,prev,length-1);
+			}
+		else if(prevPlain)
+			AddCount((b1<<8)|iValue[prev],-1);
+		AddCount((b2<<8)|b1,-1);
+
+		int32_t tail = iRunOther[next];
+		length = iRunLength[next];
+		if(length>1)
+			{
+			AddCount((b2<<8)|b2,(length-1)/2-length/2);
+			SetRun(after,tail,length-1);
+			}
+		else if(afterPlain)
+			AddCount((iValue[after]<<8)|b2,-1);
+		}
+	else
+		{
+		int32_t tail = iRunOther[n];
+		int32_t length = iRunLength[n];
+		AddCount((b1<<8)|b1,-1);
+		if(prevPlain)
+			AddCount((b1<<8)|iValue[prev],-1);
+		if(length>2)
+			SetRun(after,tail,length-2);
+		else if(afterPlain)
+			AddCount((iValue[after]<<8)|b1,-1);
+		}
+
+	// drop second node, first one holds byte
+	iNext[n] = (int16_t)after;
+	if(after>=0)
+		iPrev[after] = (int16_t)n;
+	iState[next] = EDeleted;
+	iValue[n] = (uint8_t)byte;
+
+	if(prevPlain && iValue[prev]==byte)
+		{
+		int32_t head = iRunOther[prev];
+		int32_t length = iRunLength[prev];
+		AddCount((byte<<8)|byte,(length+1)/2-length/2);
+		SetRun(head,n,length+1);
+		}
+	else
+		{
+		SetRun(n,n,1);
+		if(prevPlain)
+			AddCount((byte<<8)|iValue[prev],1);
+		}
+	if(afterPlain)
+		AddCount((iValue[after]<<8)|byte,1);
+
+	if(prevPlain)
+		LinkPair(prev);
+	if(afterPlain)
+		LinkPair(n);
+	}
+
+void TPairIndex::Write(uint8_t* dst) const
+	{
+	for(int32_t n=iHead; n>=0; n=iNext[n])
+		{
+		if(iState[n]==EEscaped)
+			*dst++ = (uint8_t)iMarker;
+		*dst++ = iValue[n];
+		}
+	}
+
+static thread_local std::unique_ptr<TPairIndex> PairIndex;
+
+int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size)
+{
+	if(!PairIndex)
+		PairIndex.reset(new TPairIndex());
+	TPairIndex& index = *PairIndex;
+
+	int32_t originalSize = size;
+	uint8_t tokens[0x100*3];
+	int32_t tokenCount = 0;
+
+	CountBytes(src,size);
+
+	int32_t marker = -1;
+	int32_t overhead = 1+3+LeastCommonByte(marker);
+	ByteUsed(marker);
+
+	index.Build(src,size,marker);
+
+	for(int32_t r=256; r>0; --r)
+    {
+		int32_t byte;
+		int32_t byteCount = LeastCommonByte(byte);
+		int32_t pair;
+		int32_t pairCount = index.MostCommonPair(pair,overhead+1);
+		int32_t saving = pairCount-byteCount;
+		if(saving<=overhead)
+			break;
+
+		overhead = 3;
+		if(tokenCount>=32)
+			overhead = 2;
+
+		uint8_t* d=tokens+3*tokenCount;
+		++tokenCount;
+		*d++ = (uint8_t)byte;
+		ByteUsed(byte);
+		*d++ = (uint8_t)pair;
+		ByteUsed(pair&0xff);
+		*d++ = (uint8_t)(pair>>8);
+		ByteUsed(pair>>8);
+		++GlobalPairs[pair];
+
+		if(byteCount)
+			byteCount -= index.Escape(byte);
+		pairCount -= index.Replace(pair,byte);
+		assert(!byteCount);
+		assert(!pairCount);
+    }
+	size = index.Size();
+
+	SortTokens(tokens,tokenCount);
+
+	// check for not being able to compress...
+	if(size>originalSize)
+    {
+		*dst++ = 0; // store zero token count
+		memcpy(dst,src,originalSize); // store original data
+		return originalSize+1;
+    }
+
+	uint8_t* originalDst = dst;
+	dst = StoreTokens(dst,tokens,tokenCount,marker);
+	index.Write(dst);
+	dst += size;
+
+	++GlobalTokenCounts[tokenCount];
+	return dst-originalDst;
+}
+
+
 // TODO: Unpak() has many warnings for shadowing variables. ...
 //This code stable and works for years. Look close after self-testing start working properly.
 #pragma GCC diagnostic push
@@ -469,8 +951,8 @@ done_d:
 #pragma GCC diagnostic pop
 
 
-uint8_t PakBuffer[MaxBlockSize*4];
-uint8_t UnpakBuffer[MaxBlockSize];
+static thread_local uint8_t PakBuffer[MaxBlockSize*4];
+static thread_local uint8_t UnpakBuffer[MaxBlockSize];
 
 
 int32_t BytePairCompress(uint8_t* dst, uint8_t* src, int32_t size)
@@ -21,6 +21,8 @@
 
 int32_t BytePairCompress(uint8_t* dst, uint8_t* src, int32_t size);
 int32_t Pak(uint8_t* dst, uint8_t* src, int32_t size);
+/// Original packer: rescans page for every token. Pak() output must be the same.
+int32_t PakReference(uint8_t* dst, uint8_t* src, int32_t size);
 int32_t Unpak(uint8_t* dst, uint8_t* src, int32_t srcSize, uint8_t*& srcNext);
 
 #endif
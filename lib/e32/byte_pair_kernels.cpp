@@ -0,0 +1,299 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Inner loops of bytepair packer.
+//
+// Vector versions compare whole vector against marker (and token bytes),
+// copy it as is if nothing found, else copy bytes before first match and
+// handle matched token as scalar version does.
+//
+//
+
+#include <string.h>
+
+#include "cpu_features.h"
+#include "byte_pair_kernels.h"
+
+#if E32_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/// Original loop from CountBytes()
+void HistogramScalar(const uint8_t* data, int32_t size, uint16_t* counts)
+{
+    memset(counts, 0, 0x100 * sizeof(uint16_t));
+    const uint8_t* dataEnd = data + size;
+    while(data < dataEnd)
+        ++counts[*data++];
+}
+
+/// Four tables break dependency between increments of the same counter
+void HistogramSplit(const uint8_t* data, int32_t size, uint16_t* counts)
+{
+    uint16_t t[4][0x100];
+    memset(t, 0, sizeof(t));
+    int32_t i = 0;
+    for(; i + 4 <= size; i += 4)
+    {
+        ++t[0][data[i]];
+        ++t[1][data[i + 1]];
+        ++t[2][data[i + 2]];
+        ++t[3][data[i + 3]];
+    }
+    for(; i < size; i++)
+        ++t[0][data[i]];
+    for(int32_t b = 0; b < 0x100; b++)
+        counts[b] = t[0][b] + t[1][b] + t[2][b] + t[3][b];
+}
+
+int32_t MarkBytesScalar(uint8_t* state, const uint8_t* data, int32_t size, int32_t marker)
+{
+    int32_t count = 0;
+    for(int32_t n = 0; n < size; n++)
+    {
+        state[n] = (data[n] == marker);
+        count += state[n];
+    }
+    return count;
+}
+
+/// Original loop from PakReference()
+int32_t EscapeScalar(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker)
+{
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    while(src < srcEnd)
+    {
+        int32_t b = *src++;
+        if(b == marker)
+            *dst++ = (uint8_t)b;
+        *dst++ = (uint8_t)b;
+    }
+    return dst - dstStart;
+}
+
+/// Single token of PakReference() round
+inline void SubstituteToken(uint8_t*& out, const uint8_t*& in, const uint8_t* inEnd,
+    int32_t marker, int32_t byte, int32_t pair, int32_t& escaped, int32_t& replaced)
+{
+    int32_t b = *in++;
+    if(b == marker)
+    {
+        *out++ = (uint8_t)marker;
+        b = *in++;
+    }
+    else if(b == byte)
+    {
+        *out++ = (uint8_t)marker;
+        ++escaped;
+    }
+    else if(b == (pair & 0xff) && in < inEnd && *in == (pair >> 8))
+    {
+        ++in;
+        b = byte;
+        ++replaced;
+    }
+    *out++ = (uint8_t)b;
+}
+
+int32_t SubstituteScalar(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker,
+    int32_t byte, int32_t pair, int32_t& escaped, int32_t& replaced)
+{
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    escaped = replaced = 0;
+    while(src < srcEnd)
+        SubstituteToken(dst, src, srcEnd, marker, byte, pair, escaped, replaced);
+    return dst - dstStart;
+}
+
+#if E32_X86_SIMD
+/// Copy bytes before first match, mask not empty
+inline void CopyToMatch(uint8_t*& dst, const uint8_t*& src, uint32_t mask)
+{
+    uint32_t n = __builtin_ctz(mask);
+    memcpy(dst, src, n);
+    dst += n;
+    src += n;
+}
+
+__attribute__((target("sse2")))
+int32_t MarkBytesSSE2(uint8_t* state, const uint8_t* data, int32_t size, int32_t marker)
+{
+    const __m128i m = _mm_set1_epi8((char)marker);
+    const __m128i one = _mm_set1_epi8(1);
+    int32_t count = 0;
+    int32_t n = 0;
+    for(; n + 16 <= size; n += 16)
+    {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + n)), m);
+        _mm_storeu_si128((__m128i*)(state + n), _mm_and_si128(eq, one));
+        count += __builtin_popcount(_mm_movemask_epi8(eq));
+    }
+    return count + MarkBytesScalar(state + n, data + n, size - n, marker);
+}
+
+__attribute__((target("sse2")))
+int32_t EscapeSSE2(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker)
+{
+    const __m128i m = _mm_set1_epi8((char)marker);
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    while(srcEnd - src >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)src);
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, m));
+        if(!mask)
+        {
+            _mm_storeu_si128((__m128i*)dst, v);
+            src += 16;
+            dst += 16;
+            continue;
+        }
+        CopyToMatch(dst, src, mask);
+        *dst++ = *src;
+        *dst++ = *src++;
+    }
+    return (dst - dstStart) + EscapeScalar(dst, src, srcEnd - src, marker);
+}
+
+__attribute__((target("sse2")))
+int32_t SubstituteSSE2(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker,
+    int32_t byte, int32_t pair, int32_t& escaped, int32_t& replaced)
+{
+    const __m128i m = _mm_set1_epi8((char)marker);
+    const __m128i b = _mm_set1_epi8((char)byte);
+    const __m128i p = _mm_set1_epi8((char)pair);
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    escaped = replaced = 0;
+    while(srcEnd - src >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)src);
+        __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(v, m),
+            _mm_or_si128(_mm_cmpeq_epi8(v, b), _mm_cmpeq_epi8(v, p)));
+        uint32_t mask = _mm_movemask_epi8(eq);
+        if(!mask)
+        {
+            _mm_storeu_si128((__m128i*)dst, v);
+            src += 16;
+            dst += 16;
+            continue;
+        }
+        CopyToMatch(dst, src, mask);
+        SubstituteToken(dst, src, srcEnd, marker, byte, pair, escaped, replaced);
+    }
+    while(src < srcEnd)
+        SubstituteToken(dst, src, srcEnd, marker, byte, pair, escaped, replaced);
+    return dst - dstStart;
+}
+
+__attribute__((target("avx2")))
+int32_t MarkBytesAVX2(uint8_t* state, const uint8_t* data, int32_t size, int32_t marker)
+{
+    const __m256i m = _mm256_set1_epi8((char)marker);
+    const __m256i one = _mm256_set1_epi8(1);
+    int32_t count = 0;
+    int32_t n = 0;
+    for(; n + 32 <= size; n += 32)
+    {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + n)), m);
+        _mm256_storeu_si256((__m256i*)(state + n), _mm256_and_si256(eq, one));
+        count += __builtin_popcount(_mm256_movemask_epi8(eq));
+    }
+    return count + MarkBytesScalar(state + n, data + n, size - n, marker);
+}
+
+__attribute__((target("avx2")))
+int32_t EscapeAVX2(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker)
+{
+    const __m256i m = _mm256_set1_epi8((char)marker);
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    while(srcEnd - src >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)src);
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, m));
+        if(!mask)
+        {
+            _mm256_storeu_si256((__m256i*)dst, v);
+            src += 32;
+            dst += 32;
+            continue;
+        }
+        CopyToMatch(dst, src, mask);
+        *dst++ = *src;
+        *dst++ = *src++;
+    }
+    return (dst - dstStart) + EscapeScalar(dst, src, srcEnd - src, marker);
+}
+
+__attribute__((target("avx2")))
+int32_t SubstituteAVX2(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker,
+    int32_t byte, int32_t pair, int32_t& escaped, int32_t& replaced)
+{
+    const __m256i m = _mm256_set1_epi8((char)marker);
+    const __m256i b = _mm256_set1_epi8((char)byte);
+    const __m256i p = _mm256_set1_epi8((char)pair);
+    const uint8_t* srcEnd = src + size;
+    uint8_t* dstStart = dst;
+    escaped = replaced = 0;
+    while(srcEnd - src >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)src);
+        __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(v, m),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, b), _mm256_cmpeq_epi8(v, p)));
+        uint32_t mask = _mm256_movemask_epi8(eq);
+        if(!mask)
+        {
+            _mm256_storeu_si256((__m256i*)dst, v);
+            src += 32;
+            dst += 32;
+            continue;
+        }
+        CopyToMatch(dst, src, mask);
+        SubstituteToken(dst, src, srcEnd, marker, byte, pair, escaped, replaced);
+    }
+    while(src < srcEnd)
+        SubstituteToken(dst, src, srcEnd, marker, byte, pair, escaped, replaced);
+    return dst - dstStart;
+}
+
+const BytePairKernels SSE2Kernels = {"sse2", HistogramSplit, MarkBytesSSE2, EscapeSSE2, SubstituteSSE2};
+const BytePairKernels AVX2Kernels = {"avx2", HistogramSplit, MarkBytesAVX2, EscapeAVX2, SubstituteAVX2};
+#endif // E32_X86_SIMD
+
+const BytePairKernels ScalarKernels = {"scalar", HistogramScalar, MarkBytesScalar, EscapeScalar, SubstituteScalar};
+
+const BytePairKernels& ScalarBytePairKernels()
+{
+    return ScalarKernels;
+}
+
+static const BytePairKernels& SelectBytePairKernels()
+{
+#if E32_X86_SIMD
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.iAVX2)
+        return AVX2Kernels;
+    if(cpu.iSSE2)
+        return SSE2Kernels;
+#endif // E32_X86_SIMD
+    return ScalarKernels;
+}
+
+const BytePairKernels& GetBytePairKernels()
+{
+    static const BytePairKernels& kernels = SelectBytePairKernels();
+    return kernels;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Inner loops of bytepair packer. SSE2 and AVX2 versions selected at
+// runtime by CPU features, plain C++ versions used everywhere else.
+// All versions give the same results.
+//
+//
+
+#ifndef BYTE_PAIR_KERNELS_H
+#define BYTE_PAIR_KERNELS_H
+
+#include <cstdint>
+
+struct BytePairKernels
+{
+    const char* iName;
+    /// counts[b] = occurrences of byte b in data, size up to 0xffff
+    void (*iHistogram)(const uint8_t* data, int32_t size, uint16_t* counts);
+    /// state[n] = 1 if data[n]==marker else 0. Returns count of markers.
+    int32_t (*iMarkBytes)(uint8_t* state, const uint8_t* data, int32_t size, int32_t marker);
+    /// Copy data to dst, marker written twice. Returns size of dst.
+    int32_t (*iEscape)(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker);
+    /// One PakReference() round on escaped data: escape byte, replace pair
+    /// with byte. Returns size of dst.
+    int32_t (*iSubstitute)(uint8_t* dst, const uint8_t* src, int32_t size, int32_t marker,
+        int32_t byte, int32_t pair, int32_t& escaped, int32_t& replaced);
+};
+
+/// Best kernels for this CPU
+const BytePairKernels& GetBytePairKernels();
+/// Plain C++ kernels
+const BytePairKernels& ScalarBytePairKernels();
+
+#endif // BYTE_PAIR_KERNELS_H
@@ -0,0 +1,58 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// CPU features detected at runtime.
+//
+//
+
+#include <cstdint>
+
+#include "cpu_features.h"
+
+#if E32_X86_SIMD
+#include <cpuid.h>
+
+/// AVX registers usable only if OS saves them on context switch
+static bool OSSavesAVX()
+{
+    uint32_t lo, hi;
+    __asm__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (lo & 0x6) == 0x6; // XMM and YMM state
+}
+
+static CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures f;
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return f;
+    f.iSSE2 = edx & bit_SSE2;
+    f.iSSE41 = ecx & bit_SSE4_1;
+    f.iPCLMUL = ecx & bit_PCLMUL;
+    bool avx = (ecx & bit_AVX) && (ecx & bit_OSXSAVE) && OSSavesAVX();
+    if(avx && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        f.iAVX2 = ebx & bit_AVX2;
+    return f;
+}
+#else
+static CpuFeatures DetectCpuFeatures()
+{
+    return CpuFeatures();
+}
+#endif // E32_X86_SIMD
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// CPU features detected at runtime, so one binary uses SIMD code
+// where CPU has it and plain C++ elsewhere.
+//
+//
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define E32_X86_SIMD 1
+#else
+#define E32_X86_SIMD 0
+#endif
+
+struct CpuFeatures
+{
+    bool iSSE2 = false;
+    bool iSSE41 = false;
+    bool iAVX2 = false;
+    bool iPCLMUL = false;
+};
+
+/// Detected once, safe to call from any thread
+const CpuFeatures& GetCpuFeatures();
+
+#endif // CPU_FEATURES_H
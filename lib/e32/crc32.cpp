@@ -0,0 +1,261 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// CRC-32 engines.
+//
+// Slice-by-N: table k holds CRC of byte followed by k zero bytes, so N
+// bytes are looked up independently and xored.
+// PCLMUL: four 128 bit lanes multiplied by x^512 and x^576 mod P fold
+// next 64 bytes, then lanes folded to one and Barrett reduced to 32 bits.
+// Constants are the same as in zlib and Linux kernel.
+//
+//
+
+#include "crc32.h"
+#include "e32common.h"
+#include "cpu_features.h"
+
+#if E32_X86_SIMD && defined(__x86_64__)
+#define E32_CRC32_PCLMUL 1
+#include <immintrin.h>
+#else
+#define E32_CRC32_PCLMUL 0
+#endif
+
+const uint32_t KCrc32Poly = 0xedb88320;
+
+struct Crc32Tables
+{
+    uint32_t iTable[16][256];
+    uint32_t iX2N[32]; // x^(2^n) mod P, to shift CRC by zero bytes
+};
+
+/// Product of polynomials a and b mod P, bit 31 is x^0
+constexpr uint32_t MultModP(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+    for(;;)
+    {
+        if(a & m)
+        {
+            p ^= b;
+            if((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ KCrc32Poly : b >> 1;
+    }
+    return p;
+}
+
+constexpr Crc32Tables MakeCrc32Tables()
+{
+    Crc32Tables t = {};
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ KCrc32Poly : crc >> 1;
+        t.iTable[0][i] = crc;
+    }
+    for(int k = 1; k < 16; k++)
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t prev = t.iTable[k - 1][i];
+            t.iTable[k][i] = (prev >> 8) ^ t.iTable[0][prev & 0xff];
+        }
+    }
+    uint32_t p = 1u << 30; // x^1
+    t.iX2N[0] = p;
+    for(int n = 1; n < 32; n++)
+        t.iX2N[n] = p = MultModP(p, p);
+    return t;
+}
+
+static constexpr Crc32Tables Tables = MakeCrc32Tables();
+
+/// Little endian load on any host, compilers make it single move
+static inline uint32_t Load32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/// Original loop from Crc32()
+static uint32_t Crc32Bytes(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const uint8_t* end = data + size;
+    while(data < end)
+        crc = (crc >> 8) ^ Tables.iTable[0][(crc ^ *data++) & 0xff];
+    return crc;
+}
+
+static uint32_t Crc32Slice8(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const auto& t = Tables.iTable;
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        uint32_t a = crc ^ Load32(data);
+        uint32_t b = Load32(data + 4);
+        crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+              t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^ t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+    }
+    return Crc32Bytes(crc, data, size);
+}
+
+static uint32_t Crc32Slice16(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const auto& t = Tables.iTable;
+    for(; size >= 16; size -= 16, data += 16)
+    {
+        uint32_t a = crc ^ Load32(data);
+        uint32_t b = Load32(data + 4);
+        uint32_t c = Load32(data + 8);
+        uint32_t d = Load32(data + 12);
+        crc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][a >> 24] ^
+              t[11][b & 0xff] ^ t[10][(b >> 8) & 0xff] ^ t[9][(b >> 16) & 0xff] ^ t[8][b >> 24] ^
+              t[7][c & 0xff] ^ t[6][(c >> 8) & 0xff] ^ t[5][(c >> 16) & 0xff] ^ t[4][c >> 24] ^
+              t[3][d & 0xff] ^ t[2][(d >> 8) & 0xff] ^ t[1][(d >> 16) & 0xff] ^ t[0][d >> 24];
+    }
+    return Crc32Bytes(crc, data, size);
+}
+
+#if E32_CRC32_PCLMUL
+/// Lane multiplied by both halves of k and added to next data
+__attribute__((target("pclmul,sse4.1")))
+static inline __m128i Fold(__m128i x, __m128i k, __m128i next)
+{
+    __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t Crc32Pclmul(uint32_t crc, const uint8_t* data, size_t size)
+{
+    if(size < 64)
+        return Crc32Slice16(crc, data, size);
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641); // mu and P'
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)data);
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    data += 64;
+    size -= 64;
+
+    for(; size >= 64; size -= 64, data += 64)
+    {
+        x1 = Fold(x1, k1k2, _mm_loadu_si128((const __m128i*)data));
+        x2 = Fold(x2, k1k2, _mm_loadu_si128((const __m128i*)(data + 16)));
+        x3 = Fold(x3, k1k2, _mm_loadu_si128((const __m128i*)(data + 32)));
+        x4 = Fold(x4, k1k2, _mm_loadu_si128((const __m128i*)(data + 48)));
+    }
+
+    x1 = Fold(x1, k3k4, x2);
+    x1 = Fold(x1, k3k4, x3);
+    x1 = Fold(x1, k3k4, x4);
+    for(; size >= 16; size -= 16, data += 16)
+        x1 = Fold(x1, k3k4, _mm_loadu_si128((const __m128i*)data));
+
+    // 128 bits to 64
+    __m128i t = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+    t = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5, 0x00), t);
+
+    // Barrett reduction to 32 bits
+    t = _mm_and_si128(x1, mask32);
+    t = _mm_clmulepi64_si128(t, poly, 0x10);
+    t = _mm_and_si128(t, mask32);
+    t = _mm_clmulepi64_si128(t, poly, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    crc = _mm_extract_epi32(x1, 1);
+
+    return Crc32Slice16(crc, data, size);
+}
+
+const Crc32Engine PclmulEngine = {"pclmul", Crc32Pclmul};
+#endif // E32_CRC32_PCLMUL
+
+const Crc32Engine BytesEngine = {"bytes", Crc32Bytes};
+const Crc32Engine Slice8Engine = {"slice8", Crc32Slice8};
+const Crc32Engine Slice16Engine = {"slice16", Crc32Slice16};
+
+static const Crc32Engine& SelectCrc32Engine()
+{
+#if E32_CRC32_PCLMUL
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.iPCLMUL && cpu.iSSE41)
+        return PclmulEngine;
+#endif // E32_CRC32_PCLMUL
+    return Slice16Engine;
+}
+
+const Crc32Engine& GetCrc32Engine()
+{
+    static const Crc32Engine& engine = SelectCrc32Engine();
+    return engine;
+}
+
+static std::vector<const Crc32Engine*> ListCrc32Engines()
+{
+    std::vector<const Crc32Engine*> engines = {&BytesEngine, &Slice8Engine, &Slice16Engine};
+#if E32_CRC32_PCLMUL
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.iPCLMUL && cpu.iSSE41)
+        engines.push_back(&PclmulEngine);
+#endif // E32_CRC32_PCLMUL
+    return engines;
+}
+
+const std::vector<const Crc32Engine*>& Crc32Engines()
+{
+    static const std::vector<const Crc32Engine*> engines = ListCrc32Engines();
+    return engines;
+}
+
+uint32_t Crc32Update(uint32_t crc, const void* ptr, size_t length)
+{
+    return GetCrc32Engine().iUpdate(crc, (const uint8_t*)ptr, length);
+}
+
+/// CRC has no initial value and final xor, so A followed by B is
+/// A shifted by zero bytes of B length plus B
+uint32_t Crc32Combine(uint32_t crcA, uint32_t crcB, size_t lengthB)
+{
+    uint32_t shift = 1u << 31; // x^0
+    for(uint32_t k = 3; lengthB; lengthB >>= 1, k++) // bytes to bits: x^(2^3) per byte
+    {
+        if(lengthB & 1)
+            shift = MultModP(Tables.iX2N[k & 31], shift);
+    }
+    return MultModP(shift, crcA) ^ crcB;
+}
+
+/**
+Performs a CCITT CRC-32 checksum on the specified data.
+
+@return         A 32 bit integer contain the CRC value.
+*/
+uint32_t Crc32(const void* ptr, uint32_t length)
+{
+    return Crc32Update(0, ptr, length);
+}
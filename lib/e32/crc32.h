@@ -0,0 +1,48 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// CRC-32 used by E32Image header and .crc files: reflected polynomial
+// 0xEDB88320, starts from 0 and has no final xor, so Crc32() of empty
+// data is 0 and CRC of joined buffers is linear on CRCs of parts.
+//
+// Slice-by-8 and slice-by-16 engines take 8 or 16 bytes per step, PCLMUL
+// engine folds 64 bytes per step on x86-64. Best engine selected at
+// runtime by CPU features, all engines give the same results.
+//
+//
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct Crc32Engine
+{
+    const char* iName;
+    /// CRC of data appended to data with CRC crc
+    uint32_t (*iUpdate)(uint32_t crc, const uint8_t* data, size_t size);
+};
+
+/// Best engine for this CPU
+const Crc32Engine& GetCrc32Engine();
+/// Every engine this CPU runs, byte at a time one first
+const std::vector<const Crc32Engine*>& Crc32Engines();
+
+/// Continue CRC of previous data with next part: Crc32Update(0, p, n) == Crc32(p, n)
+uint32_t Crc32Update(uint32_t crc, const void* ptr, size_t length);
+/// CRC of A followed by B from CRCs of A, B and length of B
+uint32_t Crc32Combine(uint32_t crcA, uint32_t crcB, size_t lengthB);
+
+#endif // CRC32_H
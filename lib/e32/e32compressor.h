@@ -19,16 +19,77 @@
 #define E32COMPRESSOR_H_INCLUDED
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class CInflater;
+class TFileInput;
+
+#pragma pack(push, 1)
+//! Begins every bytepair compressed part of E32Image, see bpe_manager.cpp
+struct IndexTableHeader
+{
+    int32_t	iSizeOfData;		// Includes the index and compressed pages
+    int32_t	iDecompressedSize;
+    uint16_t   iNumberOfPages;
+};
+#pragma pack(pop)
 
 //! set input buffer as nullptr to decompress next block
 uint32_t DecompressBPE(const char* src, char* dst);
 //! set input and output buffers as nullptr to decompress next block
 uint32_t CompressBPE(const char* src, uint32_t srcSize, char* dst, uint32_t dstSize);
 std::vector<char> CompressBPE(std::vector<char> src);
+//! unpack every step page of block and compare with src, used gets size of block
+bool VerifyBPE(const char* block, uint32_t blockSize, const char* src, uint32_t srcSize,
+               uint32_t step, uint32_t& used);
 
 void DeCompressInflate(unsigned char* source, int sourcesize, unsigned char* dst, int destsize);
 uint32_t CompressDeflate(const char* source, int sourcesize, const char* dst, int destsize);
 std::vector<char> DeCompressE32Image(const std::vector<char>& source);
 std::vector<char> CompressE32Image(const std::vector<char>& source);
+//! check that compressed image unpacks to source, in full or by sample of pages
+void VerifyE32Compression(const char* source, size_t sourceSize,
+                          const std::vector<char>& compressed, bool full);
+
+//! Compressed E32Image decoded on demand: header copied at once, bytepair
+//! pages unpacked on first access, deflate stream inflated up to requested end.
+//! Size and filler of image the same as DeCompressE32Image() gives.
+class E32ImageView
+{
+    public:
+        //! source must outlive view
+        E32ImageView(const char* source, size_t size);
+        ~E32ImageView();
+        E32ImageView(const E32ImageView&) = delete;
+        E32ImageView& operator=(const E32ImageView&) = delete;
+
+        //! decode everything what covers [offset, offset + size)
+        void Decode(size_t offset, size_t size);
+        char* Data() {return iImage.data();}
+        size_t Size() const {return iImage.size();}
+    private:
+        size_t IndexPages(size_t pos, size_t offset);
+        void DecodePage(size_t page);
+    private:
+        struct Page
+        {
+            size_t iOffset = 0; // in image
+            uint32_t iSize = 0;
+            size_t iPacked = 0; // in source
+            uint16_t iPackedSize = 0;
+            bool iDecoded = false;
+        };
+    private:
+        const char* iSource = nullptr;
+        size_t iSourceSize = 0;
+        std::vector<char> iImage;
+        size_t iDataEnd = 0; // decoded data ends here, filler follows
+        std::vector<Page> iPages; // bytepair pages in image order
+        bool iWarned = false;
+        TFileInput* iInput = nullptr;
+        CInflater* iInflater = nullptr;
+        size_t iInflated = 0; // deflate stream decoded up to here
+};
 
 #endif // E32COMPRESSOR_H_INCLUDED
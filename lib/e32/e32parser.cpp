@@ -23,6 +23,7 @@
 #include "e32parser.h"
 #include "e32compressor.h"
 #include "elf2e32_opt.hpp"
+#include "e32importsprocessor.hpp"
 
 int32_t Adjust(int32_t size);
 
@@ -42,9 +43,20 @@ E32Parser* E32Parser::NewL(const std::vector<char>& e32File)
     return self;
 }
 
+E32Parser* E32Parser::NewL(const char* image, size_t size)
+{
+    E32Parser* self = new E32Parser();
+    self->iBufferedFile = (char*)image;
+    self->iE32Size = size;
+    self->iDecompressed = true;
+    self->PostConstructL();
+    return self;
+}
+
 E32Parser::~E32Parser()
 {
-    delete iBufferedFile;
+    delete iView;
+    delete iMappedFile;
 }
 
 E32Parser::E32Parser(const std::string& arg):
@@ -53,7 +65,9 @@ E32Parser::E32Parser(const std::string& arg):
 
 void E32Parser::ConstructL()
 {
-    iBufferedFile = (char*)ReadFile(iE32File.c_str(), iE32Size);
+    iMappedFile = new MappedFile(iE32File.c_str());
+    iBufferedFile = iMappedFile->Data();
+    iE32Size = iMappedFile->Size();
 
     if(!iBufferedFile)
         ReportError(ZEROBUFFER, "Buffered E32Image not set at all.");
@@ -88,31 +102,36 @@ void E32Parser::PostConstructL()
 
 void E32Parser::ConstructL(const std::vector<char>& e32File)
 {
-    iE32Size = e32File.size();
-    iBufferedFile = new char[iE32Size]();
-    std::copy(e32File.begin(), e32File.end(), iBufferedFile);
+    iImage = e32File;
+    iE32Size = iImage.size();
+    iBufferedFile = iImage.data();
 }
 
 void E32Parser::DecompressImage()
 {
-    if(!IsCompressed())
+    if(!IsCompressed() || iDecompressed)
         return;
 
-    std::vector<char> buf = DeCompressE32Image( std::vector<char>(iBufferedFile, iBufferedFile + iE32Size) );
-    iE32Size = buf.size();
-    delete[] iBufferedFile;
-    iBufferedFile = nullptr;
-    iBufferedFile = new char[iE32Size]();
-    std::copy(buf.begin(), buf.end(), iBufferedFile);
+    iView = new E32ImageView(iBufferedFile, iE32Size);
+    iE32Size = iView->Size();
+    iBufferedFile = iView->Data();
 
     iHdr = (E32ImageHeader*)iBufferedFile;
     iHdrJ = (E32ImageHeaderJ*)(iBufferedFile + sizeof(E32ImageHeader));
 }
 
+/// Header always in place, compressed code and the rest decoded on demand
+void E32Parser::Decode(uint32_t offset, uint32_t size) const
+{
+    if(iView)
+        iView->Decode(offset, size);
+}
+
 const TExceptionDescriptor* E32Parser::GetExceptionDescriptor() const
 {
     uint32_t xd = iHdrV->iExceptionDescriptor;
     xd &= ~1;
+    Decode(iHdr->iCodeOffset + xd, sizeof(TExceptionDescriptor));
     return (TExceptionDescriptor *)(iBufferedFile + iHdr->iCodeOffset + xd);
 }
 
@@ -135,9 +154,34 @@ const E32ImageHeaderV* E32Parser::GetE32HdrV() const
 
 const char* E32Parser::GetBufferedImage() const
 {
+    Decode(0, iE32Size);
     return iBufferedFile;
 }
 
+const char* E32Parser::GetBufferedImage(uint32_t offset, uint32_t size) const
+{
+    Decode(offset, size);
+    return iBufferedFile;
+}
+
+const char* E32Parser::GetStoredImage() const
+{
+    if(iMappedFile)
+        return iMappedFile->Data();
+    if(!iImage.empty())
+        return iImage.data();
+    return iBufferedFile;
+}
+
+size_t E32Parser::GetStoredSize() const
+{
+    if(iMappedFile)
+        return iMappedFile->Size();
+    if(!iImage.empty())
+        return iImage.size();
+    return iE32Size;
+}
+
 
 uint32_t HdrFmtFromFlags(uint32_t aFlags)
 {
@@ -175,32 +219,42 @@ size_t E32Parser::GetFileSize() const
 
 const E32RelocSection* E32Parser::GetRelocSection(uint32_t offSet) const
 {
-    return (E32RelocSection*)(iBufferedFile + offSet);
+    Decode(offSet, sizeof(E32RelocSection));
+    E32RelocSection* s = (E32RelocSection*)(iBufferedFile + offSet);
+    Decode(offSet, 2 * sizeof(int32_t) + s->iSize);
+    return s;
 }
 
 const E32ImportSection* E32Parser::GetImportSection() const
 {
-    return (E32ImportSection*)(iBufferedFile + iHdr->iImportOffset);
+    Decode(iHdr->iImportOffset, sizeof(E32ImportSection));
+    E32ImportSection* s = (E32ImportSection*)(iBufferedFile + iHdr->iImportOffset);
+    Decode(iHdr->iImportOffset, s->iSize);
+    return s;
 }
 
 const uint32_t* E32Parser::GetImportAddressTable() const
 {
+    Decode(iHdr->iCodeOffset + iHdr->iTextSize, iHdr->iCodeSize - iHdr->iTextSize);
     return (uint32_t*)(iBufferedFile + iHdr->iCodeOffset + iHdr->iTextSize);
 }
 
 const char* E32Parser::GetImportTable() const
 {
+    Decode(iHdr->iCodeOffset, iHdr->iCodeSize);
     return (iBufferedFile + iHdr->iCodeOffset);
 }
 
 const char* E32Parser::GetDLLName(uint32_t OffsetOfDllName) const
 {
+    GetImportSection();
     return (iBufferedFile + iHdr->iImportOffset + OffsetOfDllName);
 }
 
 //! iExportDirOffset points after Export Table header
 uint32_t* E32Parser::GetExportTable() const
 {
+    Decode(iHdr->iExportDirOffset - sizeof(uint32_t), (iHdr->iExportDirCount + 1) * sizeof(uint32_t));
     return (uint32_t*)(iBufferedFile + iHdr->iExportDirOffset - sizeof(uint32_t));
 }
 
@@ -218,7 +272,11 @@ const E32EpocExpSymInfoHdr* E32Parser::GetEpocExpSymInfoHdr() const
 // We ignore that formula because my build elf2e32 set wrong header for Export Table.
 // elf2e32 shipped with SDK crashes from internal error.
 //    return (E32EpocExpSymInfoHdr*)(tbl + tbl[0] + 1);
-    return (E32EpocExpSymInfoHdr*)(tbl + iHdr->iExportDirCount + 1);
+    uint32_t offset = (char*)(tbl + iHdr->iExportDirCount + 1) - iBufferedFile;
+    Decode(offset, sizeof(E32EpocExpSymInfoHdr));
+    E32EpocExpSymInfoHdr* h = (E32EpocExpSymInfoHdr*)(iBufferedFile + offset);
+    Decode(offset, h->iSize);
+    return h;
 }
 
 uint32_t E32Parser::BSSOffset() const
@@ -290,7 +348,7 @@ void E32Parser::ParseExportBitMap()
     int32_t memsz = (nexp + 7) >> 3;
     iExportBitMap = new uint8_t[memsz];
     memset(iExportBitMap, 0xff, memsz);
-    uint32_t* exports = (uint32_t*)(iBufferedFile + iHdr->iExportDirOffset);
+    uint32_t* exports = GetExportTable() + 1;
     uint32_t hdrfmt = HdrFmtFromFlags(iHdr->iFlags);
 
     uint32_t entryPoint = EntryPoint();
@@ -28,6 +28,8 @@ struct E32RelocSection;
 struct E32ImportSection;
 struct E32EpocExpSymInfoHdr;
 struct TExceptionDescriptor;
+class MappedFile;
+class E32ImageView;
 
 class E32Parser
 {
@@ -40,6 +42,9 @@ class E32Parser
     public:
         static E32Parser* NewL(const std::string& arg);
         static E32Parser* NewL(const std::vector<char>& e32File);
+        /// Parse uncompressed image in place, header may already name compression
+        /// for the output file. Image must outlive parser.
+        static E32Parser* NewL(const char* image, size_t size);
         ~E32Parser();
 
         const E32ImageHeader* GetE32Hdr() const;
@@ -60,7 +65,13 @@ class E32Parser
 
         const char* GetDLLName(uint32_t OffsetOfDllName) const;
 
+        /// Whole image, compressed one decoded in full
         const char* GetBufferedImage() const;
+        /// Image with only [offset, offset + size) decoded
+        const char* GetBufferedImage(uint32_t offset, uint32_t size) const;
+        /// Image as stored in file, compressed one not decoded
+        const char* GetStoredImage() const;
+        size_t GetStoredSize() const;
         int32_t UncompressedFileSize() const;
         size_t GetFileSize() const;
         const E32RelocSection* GetRelocSection(uint32_t offSet) const;
@@ -70,11 +81,16 @@ class E32Parser
     private:
         void ParseExportBitMap();
         void DecompressImage();
+        void Decode(uint32_t offset, uint32_t size) const;
 
     private:
         std::streamsize iE32Size = 0;
         uint32_t isCompessed = 0;
-        char* iBufferedFile = nullptr;
+        bool iDecompressed = false; // image decompressed even if header says otherwise
+        char* iBufferedFile = nullptr; // points to iMappedFile or iImage
+        MappedFile* iMappedFile = nullptr;
+        std::vector<char> iImage;
+        E32ImageView* iView = nullptr; // decodes compressed iMappedFile or iImage on demand
 
     private:
         const std::string iE32File;
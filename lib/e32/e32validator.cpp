@@ -479,7 +479,7 @@ void E32Validator::ValidateImports() const
 		return; // no imports
 
     // buffer pointer to read relocation from...
-    uint8_t* buf = (uint8_t*)iParser->GetBufferedImage();
+    uint8_t* buf = (uint8_t*)iHdr;
 	uint8_t* bufferEnd = buf + iBufSize; //last byte of E32Image
 
     // read section header (ValidateHeader has alread checked this is OK)...
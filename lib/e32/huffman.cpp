@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <cassert>
+#include <cstring>
 
 #include "farray.h"
 #include "huffman.h"
@@ -623,6 +624,47 @@ void Huffman::Decoding(const uint32_t aHuffman[],int32_t aNumCodes,uint32_t aDec
 		HuffmanSubTree(aDecodeTree+codes-1,aDecodeTree+codes-1,&level[0]);
 }
 
+/**
+Build lookup table for huffman decoding tree
+
+@param "const uint32_t* aTree" The decoding tree from Huffman::Decoding(), must
+live as long as the table
+*/
+void THuffmanTable::Build(const uint32_t* aTree)
+{
+	iTree=aTree;
+	Fill(aTree,0,0);
+}
+
+/**
+Fill table entries for codes starting with aCode of aDepth bits, aNode decodes the rest
+*/
+void THuffmanTable::Fill(const uint32_t* aNode,int32_t aDepth,uint32_t aCode)
+{
+	++aDepth;
+	for (uint32_t bit=0;bit<2;++bit)
+	{
+		uint32_t huff=bit ? (*aNode>>16) : (*aNode&0xffff);
+		uint32_t code=(aCode<<1)|bit;
+		if (huff&KHuffTerminate)
+		{
+			TEntry e={uint16_t(huff>>1),uint8_t(aDepth),1};
+			uint32_t first=code<<(KBits-aDepth);
+			for (uint32_t i=0;i<(1u<<(KBits-aDepth));++i)
+				iEntries[first+i]=e;
+			continue;
+		}
+		const uint32_t* next=(const uint32_t*)((const uint8_t*)aNode+huff);
+		if (aDepth==KBits)
+		{
+			TEntry e={uint16_t(next-iTree),uint8_t(aDepth),0};
+			iEntries[code]=e;
+		}
+		else
+			Fill(next,aDepth,code);
+	}
+}
+
 /**
 The decoding tree for the externalised code
 */
@@ -659,6 +701,17 @@ const uint32_t HuffmanDecoding[]=
 };
 
 
+/**
+Lookup table for HuffmanDecoding, built once
+*/
+const THuffmanTable& HuffmanDecodingTable()
+{
+	static THuffmanTable table;
+	static const bool built=(table.Build(HuffmanDecoding),true);
+	(void)built;
+	return table;
+}
+
 /**
 Restore a canonical huffman encoding from a bit stream
 
@@ -689,7 +742,7 @@ void Huffman::InternalizeL(TBitInput& aInput,uint32_t aHuffman[],int32_t aNumCod
 	int32_t rl=0;
 	while (p+rl<end)
 	{
-		int32_t c=aInput.HuffmanL(HuffmanDecoding);
+		int32_t c=aInput.HuffmanL(HuffmanDecodingTable());
 		if (c<2)
 		{
 			// one of the zero codes used by RLE-0
@@ -731,17 +784,18 @@ void Huffman::InternalizeL(TBitInput& aInput,uint32_t aHuffman[],int32_t aNumCod
 }
 
 /**
-bit-stream input class
-Reverse the byte-order of a 32 bit value
-This generates optimal ARM code (4 instructions)
+Load big-endian 64 bit value
 */
-inline uint32_t reverse(uint32_t aVal)
+inline uint64_t LoadBE64(const uint8_t* aPtr)
 {
-	uint32_t v=(aVal<<16)|(aVal>>16);
-	v^=aVal;
-	v&=0xff00ffff;
-	aVal=(aVal>>8)|(aVal<<24);
-	return aVal^(v>>8);
+	uint64_t v;
+	memcpy(&v,aPtr,sizeof(v));
+#if defined(__GNUC__)
+	return __builtin_bswap64(v);
+#else
+	return ((uint64_t)aPtr[0]<<56)|((uint64_t)aPtr[1]<<48)|((uint64_t)aPtr[2]<<40)|((uint64_t)aPtr[3]<<32)|
+		((uint64_t)aPtr[4]<<24)|((uint64_t)aPtr[5]<<16)|((uint64_t)aPtr[6]<<8)|aPtr[7];
+#endif
 }
 
 /**
@@ -780,25 +834,54 @@ Bits will be read from this buffer until it is empty, at which point UnderflowL(
 */
 void TBitInput::Set(const uint8_t* aPtr, int32_t aLength, int32_t aOffset)
 {
-	size_t p=(size_t)aPtr;
-	p+=aOffset>>3;			// nearest byte to the specified bit offset
-	aOffset&=7;				// bit offset within the byte
-	const uint32_t* ptr=(const uint32_t*)(p&~3);	// word containing this byte
-	aOffset+=(p&3)<<3;		// bit offset within the word
+	iPtr=aPtr+(aOffset>>3);		// nearest byte to the specified bit offset
+	aOffset&=7;					// bit offset within the byte
+	iBits=0;
+	iCount=0;
+	iRemain=aLength;
 	if (aLength==0)
-		iCount=0;
-	else
+		return;
+	// read the first few bits of the stream
+	iBits=(uint64_t)(uint8_t)(*iPtr++<<aOffset)<<56;
+	iCount=8-aOffset;
+	iRemain-=iCount;
+	if (iRemain<0)
 	{
-		// read the first few bits of the stream
-		iBits=reverse(*ptr++)<<aOffset;
-		aOffset=32-aOffset;
-		aLength-=aOffset;
-		if (aLength<0)
-			aOffset+=aLength;
-		iCount=aOffset;
+		iCount+=iRemain;
+		iRemain=0;
+	}
+}
+
+/**
+Top up the bit buffer to at least 57 bits if input has them.
+
+Whole 8 bytes loaded at once while far from the end of the input. Bits below
+iCount may hold next data, they are reloaded with the same values later.
+*/
+inline void TBitInput::Refill()
+{
+	if (iRemain>=64)
+	{
+		int32_t bytes=(63-iCount)>>3;
+		iBits|=LoadBE64(iPtr)>>iCount;
+		iPtr+=bytes;
+		iCount+=bytes<<3;
+		iRemain-=bytes<<3;
+		return;
+	}
+	while (iCount<=56 && iRemain>0)
+	{
+		iBits|=(uint64_t)*iPtr++<<(56-iCount);
+		if (iRemain<8)
+		{
+			iCount+=iRemain;
+			iBits&=~0ull<<(64-iCount);	// scrub bits past the stream
+			iRemain=0;
+			break;
+		}
+		iCount+=8;
+		iRemain-=8;
 	}
-	iRemain=aLength;
-	iPtr=ptr;
 }
 
 #ifndef __HUFFMAN_MACHINE_CODED__
@@ -816,13 +899,7 @@ data
 */
 uint32_t TBitInput::ReadL()
 {
-	int32_t c=iCount;
-	uint32_t bits=iBits;
-	if (--c<0)
-		return ReadL(1);
-	iCount=c;
-	iBits=bits<<1;
-	return bits>>31;
+	return ReadL(1);
 }
 
 /**
@@ -846,44 +923,20 @@ uint32_t TBitInput::ReadL(int32_t aSize)
 {
 	if (!aSize)
 		return 0;
-	uint32_t val=0;
-	uint32_t bits=iBits;
-	iCount-=aSize;
-	while (iCount<0)
+	if (iCount<aSize)
 	{
-		// need more bits
-#ifdef __CPU_X86
-		// X86 does not allow shift-by-32
-		if (iCount+aSize!=0)
-			val|=bits>>(32-(iCount+aSize))<<(-iCount);	// scrub low order bits
-#else
-		val|=bits>>(32-(iCount+aSize))<<(-iCount);	// scrub low order bits
-#endif
-		aSize=-iCount;	// bits still required
-		if (iRemain>0)
-		{
-			bits=reverse(*iPtr++);
-			iCount+=32;
-			iRemain-=32;
-			if (iRemain<0)
-				iCount+=iRemain;
-		}
-		else
+		Refill();
+		while (iCount<aSize)
 		{
+			// the derived class may Set() more data
 			UnderflowL();
-			bits=iBits;
-			iCount-=aSize;
+			Refill();
 		}
 	}
-
-#ifdef __CPU_X86
-	// X86 does not allow shift-by-32
-	iBits=aSize==32?0:bits<<aSize;
-#else
-	iBits=bits<<aSize;
-#endif
-
-	return val|(bits>>(32-aSize));
+	uint32_t val=(uint32_t)(iBits>>(64-aSize));
+	iBits<<=aSize;
+	iCount-=aSize;
+	return val;
 }
 
 /**
@@ -913,6 +966,33 @@ uint32_t TBitInput::HuffmanL(const uint32_t* aTree)
 	return huff>>17;
 }
 
+/**
+Read and decode a Huffman Code with lookup table
+
+Same as HuffmanL(const uint32_t*) for the tree used to build aTable, but most
+codes decoded with single table lookup.
+
+@param "const THuffmanTable& aTable" The lookup table of huffman decoding tree
+
+@return The symbol that was decoded
+
+@leave "UnderflowL()" It the bit stream is exhausted more UnderflowL is called to get more
+data
+*/
+uint32_t TBitInput::HuffmanL(const THuffmanTable& aTable)
+{
+	if (iCount<THuffmanTable::KBits)
+		Refill();
+	const THuffmanTable::TEntry& e=aTable.iEntries[iBits>>(64-THuffmanTable::KBits)];
+	if (e.iLength>iCount)	// end of stream, let tree walk report underflow
+		return HuffmanL(aTable.iTree);
+	iBits<<=e.iLength;
+	iCount-=e.iLength;
+	if (e.iLeaf)
+		return e.iValue;
+	return HuffmanL(aTable.iTree+e.iValue);
+}
+
 #endif
 
 /**
@@ -22,6 +22,7 @@
 #define __HUFFMAN_H__
 
 #include <fstream>
+#include <cstdint>
 #include <stddef.h>
 
 /** Bit output stream.
@@ -127,6 +128,35 @@ class TBufferedOutput : public TBitOutput
 		const char* iOutStream;
 };
 
+/**
+Lookup table for Huffman decoding tree from Huffman::Decoding().
+
+Indexed by next KBits bits of input. Entry holds symbol and code length for
+codes up to KBits bits, for longer ones it holds tree node where decoding
+continues bit by bit.
+@internalComponent
+@released
+*/
+class THuffmanTable
+{
+public:
+	enum {KBits=10};
+	struct TEntry
+	{
+		uint16_t iValue;	// symbol or index of tree node
+		uint8_t iLength;	// bits used
+		uint8_t iLeaf;
+	};
+public:
+	void Build(const uint32_t* aTree);
+private:
+	void Fill(const uint32_t* aNode,int32_t aDepth,uint32_t aCode);
+private:
+	friend class TBitInput;
+	const uint32_t* iTree;
+	TEntry iEntries[1<<KBits];
+};
+
 /**
 Class for Bit input stream.
 Good for reading bit streams for packed, compressed or huffman data algorithms.
@@ -144,14 +174,16 @@ public:
     uint32_t ReadL();
     uint32_t ReadL(int32_t aSize);
     uint32_t HuffmanL(const uint32_t* aTree);
+    uint32_t HuffmanL(const THuffmanTable& aTable);
     virtual ~TBitInput();
 private:
     virtual void UnderflowL();
+    inline void Refill();
 private:
-    int32_t iCount;
-    uint32_t iBits;
-    int32_t iRemain;
-    const uint32_t* iPtr;
+    int32_t iCount;     // valid bits at top of iBits
+    uint64_t iBits;
+    int32_t iRemain;    // bits left in buffer after iPtr
+    const uint8_t* iPtr;
 };
 
 /**
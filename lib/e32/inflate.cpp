@@ -131,6 +131,8 @@ void CInflater::InitL()
 	// convert the length tables into huffman decoding trees
 	Huffman::Decoding(iEncoding->iLitLen,TEncoding::ELitLens,iEncoding->iLitLen);
 	Huffman::Decoding(iEncoding->iDistance,TEncoding::EDistances,iEncoding->iDistance,KDeflateDistCodeBase);
+	iLitLenTable.Build(iEncoding->iLitLen);
+	iDistanceTable.Build(iEncoding->iDistance);
 }
 
 /*
@@ -145,7 +147,7 @@ int32_t CInflater::InflateL()
 	// empty the history buffer into the output
 	uint8_t* out=iOut;
 	uint8_t* const end=out+KDeflateMaxDistance;
-	const uint32_t* tree=iEncoding->iLitLen;
+	const THuffmanTable* table=&iLitLenTable;
 	if (iLen<0)	// EOF
 		return 0;
 	if (iLen>0)
@@ -155,7 +157,7 @@ int32_t CInflater::InflateL()
 	{
 		// get a huffman code
 		{
-			int32_t val=iBits->HuffmanL(tree)-TEncoding::ELiterals;
+			int32_t val=iBits->HuffmanL(*table)-TEncoding::ELiterals;
 			if (val<0)
 			{
 				*out++=uint8_t(val);
@@ -179,7 +181,7 @@ int32_t CInflater::InflateL()
 			if (val<KDeflateDistCodeBase-TEncoding::ELiterals)
 			{	// length code... get the code
 				iLen=code+KDeflateMinLength;
-				tree=iEncoding->iDistance;
+				table=&iDistanceTable;
 				continue;			// read the huffman code
 			}
 			// distance code
@@ -203,7 +205,7 @@ int32_t CInflater::InflateL()
 					from-=KDeflateMaxDistance;
 			}while (--tfr!=0);
 			iRptr=from;
-			tree=iEncoding->iLitLen;
+			table=&iLitLenTable;
 	};
 
 	return out-iOut;
@@ -50,6 +50,8 @@ class CInflater
 		const uint8_t* iAvail;			// available data
 		const uint8_t* iLimit;
 		TEncoding* iEncoding;
+		THuffmanTable iLitLenTable;
+		THuffmanTable iDistanceTable;
 		uint8_t* iOut;					// circular buffer for distance matches
 		uint8_t iHuff[EBufSize+ESafetyZone];	// huffman data
 };
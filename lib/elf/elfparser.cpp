@@ -60,7 +60,7 @@ ElfParser::ElfParser(const string& elf): iFile(elf)
 
 ElfParser::~ElfParser()
 {
-    delete[] iFileBuf;
+    delete iMappedFile;
 }
 
 const char* ElfParser::CodeSegment() const
@@ -80,7 +80,10 @@ uint32_t* ElfParser::GetDSOImportsOrdinals() const
 
 void ElfParser::GetElfFileLayout()
 {
-    iFileBuf = ReadFile(iFile.c_str(), iFileBufSize);
+    // private mapping: ElfWithFixedHashTable() and relocation fixes write to own copy
+    iMappedFile = new MappedFile(iFile.c_str());
+    iFileBuf = iMappedFile->Data();
+    iFileBufSize = iMappedFile->Size();
     iElfHeader = ELF_ENTRY_PTR(Elf32_Ehdr, iFileBuf, 0);
 
     ValidateElfImage();
@@ -515,15 +518,68 @@ Elf32_Sym* ElfParser::LookupStaticSymbol(const char* aName) const
 	if(!iSymTab || !iStrTab)
         ReportError(ErrorCodes::NOSTATICSYMBOLS);
 
-    Elf32_Sym* aSymTab = iSymTab;
-    for(; aSymTab < iLim; aSymTab++)
-	{
-		if (!aSymTab->st_name) continue;
-		char* aSymName = iStrTab + aSymTab->st_name;
-		if (!strcmp(aSymName, aName))
-			return aSymTab;
-	}
-    return nullptr;
+    std::call_once(iStaticIndexed, &ElfParser::IndexStaticSymbols, this);
+    auto it = iStaticIndex.find(aName);
+    if(it == iStaticIndex.end())
+        return nullptr;
+    return it->second;
+}
+
+const char KVeneerPrefix[] = "$Ven$";
+
+/// Veneers collected while indexed, other prefixes need table scan
+vector<Elf32_Sym*> ElfParser::LookupStaticSymbols(const char* aPrefix) const
+{
+    vector<Elf32_Sym*> r;
+    if(!iSymTab || !iStrTab)
+        return r;
+
+    size_t length = strlen(aPrefix);
+    if(!strncmp(aPrefix, KVeneerPrefix, sizeof(KVeneerPrefix) - 1))
+    {
+        std::call_once(iStaticIndexed, &ElfParser::IndexStaticSymbols, this);
+        for(Elf32_Sym* s: iStaticVeneers)
+        {
+            if(!strncmp(iStrTab + s->st_name, aPrefix, length))
+                r.push_back(s);
+        }
+        return r;
+    }
+    for(Elf32_Sym* s = iSymTab; s < iLim; s++)
+    {
+        if(s->st_name && !strncmp(iStrTab + s->st_name, aPrefix, length))
+            r.push_back(s);
+    }
+    return r;
+}
+
+/// The first symbol wins for duplicated names as for table scan
+void ElfParser::IndexStaticSymbols() const
+{
+    iStaticIndex.reserve(iLim - iSymTab);
+    for(Elf32_Sym* s = iSymTab; s < iLim; s++)
+    {
+        if(!s->st_name)
+            continue;
+        const char* name = iStrTab + s->st_name;
+        iStaticIndex.emplace(name, s);
+        if(!strncmp(name, KVeneerPrefix, sizeof(KVeneerPrefix) - 1))
+            iStaticVeneers.push_back(s);
+    }
+}
+
+/// FNV-1a
+size_t ElfParser::NameHash::operator()(const char* s) const
+{
+    uint32_t h = 2166136261u;
+    for(; *s; s++)
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    return h;
+}
+
+bool ElfParser::NameEqual::operator()(const char* a, const char* b) const
+{
+    return strcmp(a, b) == 0;
 }
 
 Elf32_Verneed* ElfParser::GetElf32_Verneed() const
@@ -18,10 +18,14 @@
 #ifndef ELFPARSER_H
 #define ELFPARSER_H
 
+#include <mutex>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "elfdefs.h"
 
+class MappedFile;
+
 struct Elf32_Sym;
 struct Elf32_Rel;
 struct Elf32_Rela;
@@ -66,6 +70,8 @@ class ElfParser
     public:
         Elf32_Sym* GetSymbolTableEntity(uint32_t index) const;
         Elf32_Sym* LookupStaticSymbol(const char* aName) const;
+        /// Static symbols with names started from aPrefix in symbol table order
+        std::vector<Elf32_Sym*> LookupStaticSymbols(const char* aPrefix) const;
         Elf32_Phdr* GetSegmentAtAddr(Elf32_Addr addr) const;
         Elf32_Phdr* Segment(uint16_t aType) const;
         ESegmentType SegmentType(Elf32_Addr addr) const;
@@ -98,8 +104,10 @@ class ElfParser
         void ProcessSectionHeaders();
         void ProcessProgHeaders();
         void ProcessDynamicTable();
+        void IndexStaticSymbols() const;
     private:
         std::string iFile;
+        MappedFile* iMappedFile = nullptr;
         const char* iFileBuf = nullptr;
         std::streamsize iFileBufSize = 0;
     private:
@@ -115,6 +123,20 @@ class ElfParser
         Elf32_Sym* iSymTab = nullptr;
         char* iStrTab = nullptr;
         Elf32_Sym* iLim = nullptr;
+    private:
+        struct NameHash
+        {
+            size_t operator()(const char* s) const;
+        };
+        struct NameEqual
+        {
+            bool operator()(const char* a, const char* b) const;
+        };
+        /** Static symbols by name and veneer symbols in table order, built on
+         *  first lookup. Debug images have hundreds of thousands local symbols. */
+        mutable std::once_flag iStaticIndexed;
+        mutable std::unordered_map<const char*, Elf32_Sym*, NameHash, NameEqual> iStaticIndex;
+        mutable std::vector<Elf32_Sym*> iStaticVeneers;
     private:
         const char* iCommentSection = nullptr;
     private:
@@ -20,7 +20,7 @@
 #if !defined STATICLIBS_SYMBOLS_H
 #define STATICLIBS_SYMBOLS_H
 
-static const char * Unwantedruntimesymbols[] =
+static constexpr const char* Unwantedruntimesymbols[] =
 {
 "_ZN10__cxxabiv116__enum_type_infoD0Ev",
 "_ZN10__cxxabiv116__enum_type_infoD1Ev",
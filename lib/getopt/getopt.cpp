@@ -18,8 +18,15 @@
 #include "getopt_opts.h"
 #include "elf2e32_opt.hpp"
 
-static bool wait_arg_val = false;
-static Opts full_opt;
+static thread_local bool wait_arg_val = false;
+static thread_local Opts full_opt;
+
+void ResetOpts()
+{
+    wait_arg_val = false;
+    full_opt = Opts();
+}
+
 bool NeedRawArg(Flags::Flags flag)
 {
     if(flag == Flags::CASE_SENSITIVE)
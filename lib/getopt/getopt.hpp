@@ -29,6 +29,7 @@ struct Opts
 };
 
 struct Opts getopt(const std::string& argc);
+void ResetOpts();
 
 struct option		/* specification for a long form option...	*/
 {
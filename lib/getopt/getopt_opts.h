@@ -81,11 +81,19 @@ static struct option long_opts[] =
     {"man-build-dsodump",     no_argument,  Flags::NONE, OptionsType::EMANDSODUMP},
     {"man-build-artifacts",   no_argument,  Flags::NONE, OptionsType::EMANARTIFACTS},
     {"help",                  no_argument,  Flags::NONE, OptionsType::EHELP},
+    {"batch",           required_argument,  Flags::CASE_SENSITIVE, OptionsType::EBATCH},
+    {"jobs",            required_argument,  Flags::NONE, OptionsType::EJOBS},
+    {"serve",           required_argument,  Flags::CASE_SENSITIVE, OptionsType::ESERVE},
+    {"connect",         required_argument,  Flags::CASE_SENSITIVE, OptionsType::ECONNECT},
+    {"cache",           required_argument,  Flags::CASE_SENSITIVE, OptionsType::ECACHE},
+    {"profile",         required_argument,  Flags::CASE_SENSITIVE, OptionsType::EPROFILE},
+    {"repack",          required_argument,  Flags::CASE_SENSITIVE, OptionsType::EREPACK},
     // dev options
     {"filecrc",         optional_argument,  Flags::CASE_SENSITIVE, OptionsType::FILECRC},
     {"time",            required_argument,  Flags::NONE, OptionsType::TIME},
     {"verbose",         optional_argument,  Flags::NONE, OptionsType::VERBOSE},
     {"force",                 no_argument,  Flags::NONE, OptionsType::FORCEE32BUILD},
+    {"strictvalidation",      no_argument,  Flags::NONE, OptionsType::STRICTVALIDATION},
     // Nokia_Symbian_Belle_SDK_v1.0 ignored options
     {"asm",             no_argument,        Flags::NONE, OptionsType::EASM},
     {"e32tran",         required_argument,  Flags::NONE, OptionsType::EE32TRAN},
@@ -30,6 +30,8 @@
 #include "common.hpp"
 #include "e32common.h"
 #include "elfparser.h"
+#include "profiler.h"
+#include "buildcache.h"
 #include "elf2e32_opt.hpp"
 #include "artifactbuilder.h"
 #include "symbolprocessor.h"
@@ -50,23 +52,35 @@ ArtifactBuilder::~ArtifactBuilder()
 
 void ArtifactBuilder::Run()
 {
+    ValidateOptions(iOpts);
+    BuildCache cache(iOpts);
+    {
+        ProfileScope scope("BuildCache::Restore");
+        if(cache.Restore())
+            return;
+    }
     PrepareBuild();
     MakeDSO();
     MakeDef();
     MakeE32();
     MakeImportHeader(iSymbols, iOpts->iHeader);
+    ProfileScope scope("BuildCache::Store");
+    cache.Store();
 }
 
 void ArtifactBuilder::PrepareBuild()
 {
-    ValidateOptions(iOpts);
+    ProfileScope scope("PrepareBuild");
     if(!iOpts->iElfinput.empty())
     {
+        ProfileScope elf("ElfParser");
         iElfParser = new ElfParser(iOpts->iElfinput);
         iElfParser->GetElfFileLayout();
     }
+    ProfileScope symbols("SymbolProcessor");
     SymbolProcessor processor(iOpts, iElfParser);
     iSymbols = processor.GetExports();
+    ProfileCount("symbols", iSymbols.size());
 }
 
 void ArtifactBuilder::MakeDSO()
@@ -76,6 +90,7 @@ void ArtifactBuilder::MakeDSO()
 #if SET_COMPILETIME_LOAD_EXISTED_FILECRC
     CheckDSOCrc(iOpts); //builded with original tool =)
 #endif // SET_COMPILETIME_LOAD_EXISTED_FILECRC
+    ProfileScope scope("MakeDSO");
     DSOFile* dso = new DSOFile();
     dso->WriteDSOFile(iOpts, iSymbols);
     delete dso;
@@ -86,6 +101,7 @@ void ArtifactBuilder::MakeDef()
 {
     if(iOpts->iDefoutput.empty())
         return;
+    ProfileScope scope("MakeDef");
     DefFile deffile;
     deffile.WriteDefFile(iOpts->iDefoutput.c_str(), iSymbols);
 }
@@ -94,6 +110,7 @@ void ArtifactBuilder::MakeE32()
 {
     if(iOpts->iOutput.empty())
         return;
+    ProfileScope scope("MakeE32");
     BuildE32Image(iOpts, iElfParser, iSymbols);
 }
 
@@ -21,13 +21,12 @@
 #include <list>
 #include <vector>
 #include "task.hpp"
+#include "symboltable.h"
 
 class Args;
 class Symbol;
 class ElfParser;
 
-typedef std::list <Symbol*>	Symbols;
-
 class ArtifactBuilder: public Task
 {
     public:
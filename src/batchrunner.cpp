@@ -0,0 +1,193 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Run many elf2e32 jobs from manifest in one process.
+//
+//
+
+#include <thread>
+#include <fstream>
+#include <algorithm>
+
+#include "logger.h"
+#include "common.hpp"
+#include "elf2e32.h"
+#include "profiler.h"
+#include "batchrunner.h"
+#include "workerpool.h"
+#include "elf2e32_opt.hpp"
+
+BatchRunner::BatchRunner(const Args* args): iArgs(args) {}
+
+void BatchRunner::Run()
+{
+    ProfileScope scope("Batch");
+    ReadManifest();
+    iProfiler = Profiler::Current();
+    EnableDefCache();
+
+    size_t workers = iArgs->iJobs;
+    if(!workers)
+        workers = std::thread::hardware_concurrency();
+    workers = std::max<size_t>(1, std::min(workers, iJobs.size()));
+    // pages and relocs of jobs split between pool threads of the same size
+    SetWorkerThreads(iArgs->iJobs);
+
+    std::vector<std::thread> pool;
+    for(size_t i = 0; i < workers; i++)
+        pool.emplace_back(&BatchRunner::Worker, this);
+
+    // print results in manifest order while workers go ahead
+    int failed = 0;
+    for(auto& job: iJobs)
+    {
+        {
+            std::unique_lock<std::mutex> lock(iMutex);
+            iFinished.wait(lock, [&job]{return job.iFinished;});
+        }
+        Logger::Instance()->Log(job.iOutput);
+        if(job.iStatus)
+        {
+            ReportLog("Batch job at line %d failed with code %d\n", job.iLine, job.iStatus);
+            failed++;
+        }
+    }
+
+    for(auto& t: pool)
+        t.join();
+
+    ReportLog("Batch: %d jobs done, %d failed\n", (int)iJobs.size(), failed);
+    if(failed)
+        ReportError(BATCHJOBSFAILED, failed);
+}
+
+void BatchRunner::ReadManifest()
+{
+    std::ifstream fs(iArgs->iBatch);
+    if(!fs)
+        ReportError(FILEOPENERROR, iArgs->iBatch);
+
+    std::string line;
+    int lineNo = 0;
+    while(std::getline(fs, line))
+    {
+        lineNo++;
+        std::vector<std::string> argv = SplitCmdLine(line);
+        if(argv.empty() || argv[0][0] == '#')
+            continue;
+
+        // allow lines copied from build logs: "elf2e32 --opt1 --opt2"
+        if(argv[0][0] != '-')
+            argv.erase(argv.begin());
+        if(argv.empty())
+            continue;
+        for(auto& x: argv)
+        {
+            if(!x.compare(0, 7, "--batch") || !x.compare(0, 7, "--serve"))
+                ReportError(INVALIDARGUMENT, x, "line " + std::to_string(lineNo));
+        }
+
+        BatchJob job;
+        job.iLine = lineNo;
+        job.iArgv.push_back("elf2e32"); // ArgParser skips argv[0]
+        job.iArgv.insert(job.iArgv.end(), argv.begin(), argv.end());
+        iJobs.push_back(job);
+    }
+
+    if(iJobs.empty())
+        ReportError(EMPTYBATCH, iArgs->iBatch);
+}
+
+void BatchRunner::Worker()
+{
+    for(;;)
+    {
+        size_t i = iNext++;
+        if(i >= iJobs.size())
+            return;
+
+        {
+            ProfileTrack track(iProfiler, iJobs[i].iLine, "line " + std::to_string(iJobs[i].iLine));
+            iJobs[i].iStatus = RunJob(iJobs[i].iArgv, iJobs[i].iOutput);
+        }
+
+        std::lock_guard<std::mutex> lock(iMutex);
+        iJobs[i].iFinished = true;
+        iFinished.notify_one();
+    }
+}
+
+static int RunElf2E32(const std::vector<std::string>& argv)
+{
+    int res = 0;
+    try{
+        Elf2E32 task(argv);
+        task.Run();
+    }catch(ErrorCodes err){
+        res = -err;
+    }catch(...){
+        res = -ErrorCodes::UNKNOWNERROR;
+        ReportWarning(ErrorCodes::UNKNOWNERROR);
+    }
+    return res;
+}
+
+/// Same as main() but messages stored in output.
+int RunJob(const std::vector<std::string>& argv, std::string& output)
+{
+    Logger::CaptureOutput(&output);
+    int res = RunElf2E32(argv);
+    Logger::CaptureOutput(nullptr);
+    return res;
+}
+
+/// Same as main() but messages passed to sink as soon as printed.
+int RunJob(const std::vector<std::string>& argv, const OutputSink& sink)
+{
+    Logger::StreamOutput(&sink);
+    int res = RunElf2E32(argv);
+    Logger::StreamOutput(nullptr);
+    return res;
+}
+
+/// Split line to arguments by spaces. Double quotes group spaces and stripped:
+/// --libpath="C:\SDK libs" becomes --libpath=C:\SDK libs
+std::vector<std::string> SplitCmdLine(const std::string& line)
+{
+    std::vector<std::string> argv;
+    std::string arg;
+    bool quoted = false, hasArg = false;
+    for(char c: line)
+    {
+        if(c == '"')
+        {
+            quoted = !quoted;
+            hasArg = true;
+        }
+        else if(!quoted && (c == ' ' || c == '\t' || c == '\r' || c == '\n'))
+        {
+            if(hasArg)
+                argv.push_back(arg);
+            arg.clear();
+            hasArg = false;
+        }
+        else
+        {
+            arg += c;
+            hasArg = true;
+        }
+    }
+    if(hasArg)
+        argv.push_back(arg);
+    return argv;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Run many elf2e32 jobs from manifest in one process.
+// Each line of manifest holds full set of options for single job:
+//   --elfinput=foo.dll --output=foo.e32 --libpath="SDK libs" ...
+// Empty lines and lines starts with '#' skipped.
+//
+//
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include "task.hpp"
+#include "logger.h"
+
+struct Args;
+class Profiler;
+
+struct BatchJob
+{
+    int iLine = 0; // line in manifest
+    std::vector<std::string> iArgv;
+    std::string iOutput; // captured messages
+    int iStatus = 0; // same as elf2e32 exit code
+    bool iFinished = false;
+};
+
+class BatchRunner : public Task
+{
+    public:
+        BatchRunner(const Args* args);
+        virtual ~BatchRunner() {}
+        virtual void Run() final override;
+    private:
+        void ReadManifest();
+        void Worker();
+    private:
+        const Args* iArgs = nullptr;
+        std::vector<BatchJob> iJobs;
+        std::atomic<size_t> iNext{0};
+        std::mutex iMutex;
+        std::condition_variable iFinished;
+        Profiler* iProfiler = nullptr; // of --batch run, jobs recorded as own tracks
+};
+
+std::vector<std::string> SplitCmdLine(const std::string& line);
+int RunJob(const std::vector<std::string>& argv, std::string& output);
+int RunJob(const std::vector<std::string>& argv, const OutputSink& sink);
+
+#endif // BATCHRUNNER_H
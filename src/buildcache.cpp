@@ -0,0 +1,402 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Cache of ArtifactBuilder results.
+//
+// Entry file layout, all numbers in host byte order:
+//   header: magic, version, count of DSO
+//   per DSO: name, path, content hash
+//   count of outputs, per output: kind, size, data
+// String stored as size and data.
+//
+//
+
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.hpp"
+#include "e32common.h"
+#include "buildcache.h"
+#include "elf2e32_opt.hpp"
+#include "import_section.h"
+#include "e32header_section.h"
+#include "elf2e32_version.hpp"
+
+const uint32_t CacheMagic = 0x43453245; // "E2EC"
+const uint32_t CacheVersion = 2;
+
+enum CacheOutput
+{
+    EE32Image,
+    EDSOOutput,
+    EDefOutput,
+    EHeaderOutput,
+    ECacheOutputs
+};
+
+// DSO used by current job, set while cache on
+static thread_local std::vector<CacheDependency>* Dependencies = nullptr;
+
+void AddCacheDependency(const std::string& name, const std::string& path)
+{
+    if(!Dependencies)
+        return;
+    for(auto& x: *Dependencies)
+        if(x.iName == name)
+            return;
+    Dependencies->push_back({name, path, std::string()});
+}
+
+static inline uint64_t Rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t FMix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+/// MurmurHash3 x64 128 bit as hex string
+static std::string Hash(const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0, h2 = 0;
+
+    size_t blocks = size / 16;
+    for(size_t i = 0; i < blocks; i++)
+    {
+        uint64_t k1, k2;
+        memcpy(&k1, p + i * 16, 8);
+        memcpy(&k2, p + i * 16 + 8, 8);
+        k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = Rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = Rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = p + blocks * 16;
+    uint64_t k1 = 0, k2 = 0;
+    size_t rest = size & 15;
+    for(size_t i = rest; i > 8; i--)
+        k2 |= (uint64_t)tail[i - 1] << ((i - 9) * 8);
+    for(size_t i = (rest > 8) ? 8 : rest; i > 0; i--)
+        k1 |= (uint64_t)tail[i - 1] << ((i - 1) * 8);
+    if(rest > 8)
+    {
+        k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if(rest)
+    {
+        k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= size; h2 ^= size;
+    h1 += h2; h2 += h1;
+    h1 = FMix64(h1); h2 = FMix64(h2);
+    h1 += h2; h2 += h1;
+
+    std::ostringstream os;
+    os << std::hex << std::setfill('0') << std::setw(16) << h1 << std::setw(16) << h2;
+    return os.str();
+}
+
+/// Empty string for missed file
+static std::string HashFile(const std::string& file)
+{
+    if(file.empty() || (GetFileStamp(file).iSize < 0))
+        return std::string();
+    MappedFile data(file.c_str());
+    return Hash(data.Data(), data.Size());
+}
+
+struct HashedFile
+{
+    FileStamp iStamp;
+    std::string iHash;
+};
+
+static std::mutex HashLock;
+static std::map<std::string, HashedFile> HashedDSO;
+
+/// DSO hashed once while unchanged: --batch and --serve jobs share import libraries
+static std::string HashDSO(const std::string& file)
+{
+    FileStamp stamp = GetFileStamp(file);
+    if(stamp.iSize < 0)
+        return std::string();
+    {
+        std::lock_guard<std::mutex> lock(HashLock);
+        auto it = HashedDSO.find(file);
+        if((it != HashedDSO.end()) && (it->second.iStamp == stamp))
+            return it->second.iHash;
+    }
+    HashedFile h = {stamp, HashFile(file)};
+    std::lock_guard<std::mutex> lock(HashLock);
+    HashedDSO[file] = h;
+    return h.iHash;
+}
+
+static void Put(std::ostream& os, const char* name, const std::string& value)
+{
+    os << name << "=" << value.size() << ":" << value << "\n";
+}
+
+static void Put(std::ostream& os, const char* name, uint64_t value)
+{
+    os << name << "=" << value << "\n";
+}
+
+/// Options affect outputs. Taken after ValidateOptions(), so deduced ones counted too.
+/// Paths counted only where they get into outputs: the same sources built from
+/// another directory or checkout share entries.
+static std::string ArgsKey(const Args* a)
+{
+    std::ostringstream os;
+    ToolVersion tool;
+    Put(os, "tool", ((uint64_t)tool.iMajor << 32) | ((uint64_t)tool.iMinor << 16) | tool.iBuild);
+    Put(os, "cache", CacheVersion);
+    Put(os, "uid1", a->iUid1);
+    Put(os, "uid2", a->iUid2);
+    Put(os, "uid3", a->iUid3);
+    Put(os, "linkasuid", a->iLinkasUid);
+    Put(os, "sid", a->iSid);
+    Put(os, "vid", a->iVid);
+    Put(os, "heapmin", a->iHeapMin);
+    Put(os, "heapmax", a->iHeapMax);
+    Put(os, "stack", a->iStack);
+    Put(os, "fixedaddress", a->iFixedaddress);
+    Put(os, "callentry", a->iCallentry);
+    Put(os, "fpu", a->iFpu);
+    Put(os, "codepaging", (uint64_t)a->iCodePaging);
+    Put(os, "datapaging", (uint64_t)a->iDataPaging);
+    Put(os, "debuggable", a->iDebuggable);
+    Put(os, "smpsafe", a->iSmpsafe);
+    Put(os, "targettype", (uint64_t)a->iTargettype);
+    Put(os, "linkas", a->iLinkas);
+    Put(os, "compression", a->iCompressionMethod);
+    Put(os, "unfrozen", a->iUnfrozen);
+    Put(os, "ignorenoncallable", a->iIgnorenoncallable);
+    Put(os, "capability", a->iCapability);
+    Put(os, "sysdef", a->iSysdef);
+    Put(os, "nodlldata", a->iNoDlldata);
+    Put(os, "priority", a->iPriority);
+    Put(os, "excludeunwantedexports", a->iExcludeunwantedexports);
+    Put(os, "customdlltarget", a->iCustomdlltarget);
+    Put(os, "namedlookup", a->iNamedlookup);
+    // inputs keyed by content, DSO at --libpath checked by content on restore
+    Put(os, "defoutput", (uint64_t)!a->iDefoutput.empty());
+    Put(os, "output", (uint64_t)!a->iOutput.empty());
+    Put(os, "dso", FileNameFromPath(a->iDso)); // soname of DSO
+    Put(os, "dsodump", a->iDSODump);
+    Put(os, "version", a->iVersion);
+    Put(os, "header", a->iHeader); // header quotes own path
+    Put(os, "timehi", a->iTime[0]);
+    Put(os, "timelo", a->iTime[1]);
+    Put(os, "force", a->iForceE32Build);
+    return os.str();
+}
+
+/// Sequential reader for entry file, every read checks bounds
+class EntryReader
+{
+    public:
+        EntryReader(const char* data, size_t size): iPos(data), iEnd(data + size) {}
+        bool Get(uint32_t& x)
+        {
+            if((size_t)(iEnd - iPos) < sizeof(x))
+                return false;
+            memcpy(&x, iPos, sizeof(x));
+            iPos += sizeof(x);
+            return true;
+        }
+        bool Get(std::string& s)
+        {
+            uint32_t size = 0;
+            if(!Get(size) || ((size_t)(iEnd - iPos) < size))
+                return false;
+            s.assign(iPos, size);
+            iPos += size;
+            return true;
+        }
+    private:
+        const char* iPos;
+        const char* iEnd;
+};
+
+static void Put(std::ostream& os, uint32_t x)
+{
+    os.write((const char*)&x, sizeof(x));
+}
+
+static void Put(std::ostream& os, const std::string& s)
+{
+    Put(os, (uint32_t)s.size());
+    os.write(s.data(), s.size());
+}
+
+BuildCache::BuildCache(const Args* args): iArgs(args)
+{
+    // --filecrc checks outputs of real build
+    if(args->iCache.empty() || !args->iFileCrc.empty())
+        return;
+    std::string key = ArgsKey(args);
+    key += "elf:" + HashFile(args->iElfinput) + "\n";
+    key += "def:" + HashFile(args->iDefinput) + "\n";
+    iKey = Hash(key.data(), key.size());
+    Dependencies = &iDependencies;
+}
+
+BuildCache::~BuildCache()
+{
+    if(Dependencies == &iDependencies)
+        Dependencies = nullptr;
+}
+
+std::string BuildCache::EntryFile() const
+{
+    std::string dir = iArgs->iCache;
+    char last = dir.back();
+    if((last != '/') && (last != '\\'))
+        dir += "/";
+    return dir + iKey;
+}
+
+/// Outputs in order of CacheOutput
+static std::vector<std::string> Outputs(const Args* a)
+{
+    return {a->iOutput, a->iDso, a->iDefoutput, a->iHeader};
+}
+
+bool BuildCache::Restore()
+{
+    if(iKey.empty())
+        return false;
+    std::string file = EntryFile();
+    if(GetFileStamp(file).iSize <= 0)
+        return false;
+    MappedFile data(file.c_str());
+    EntryReader r(data.Data(), data.Size());
+
+    uint32_t magic = 0, version = 0, count = 0;
+    if(!r.Get(magic) || !r.Get(version) || (magic != CacheMagic) ||
+        (version != CacheVersion) || !r.Get(count))
+        return false;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        CacheDependency d;
+        if(!r.Get(d.iName) || !r.Get(d.iPath) || !r.Get(d.iHash))
+            return false;
+        // another DSO with the same name may appear earlier at --libpath
+        std::string path = FindDSOAtLibpath(d.iName, iArgs->iLibpath);
+        if(path.empty() || (HashDSO(path) != d.iHash))
+            return false;
+    }
+
+    std::vector<std::string> outputs = Outputs(iArgs);
+    std::vector<std::string> contents(ECacheOutputs);
+    if(!r.Get(count))
+        return false;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint32_t kind = 0;
+        std::string content;
+        if(!r.Get(kind) || !r.Get(content) || (kind >= ECacheOutputs) || outputs[kind].empty())
+            return false;
+        contents[kind].swap(content);
+    }
+
+    std::string& image = contents[EE32Image];
+    if(!image.empty())
+    {
+        if(image.size() < sizeof(E32ImageHeader))
+            return false;
+        E32ImageHeader* hdr = (E32ImageHeader*)&image[0];
+        SetE32Time(hdr, iArgs->iTime);
+        SetE32ImageCrc(&image[0]);
+    }
+    for(uint32_t i = 0; i < ECacheOutputs; i++)
+    {
+        if(!outputs[i].empty())
+            SaveFile(outputs[i], contents[i]);
+    }
+    if(VerboseOut())
+        ReportLog("Outputs restored from cache entry: " + file + "\n");
+    return true;
+}
+
+/// Written to temporary file and renamed: concurrent builds never see partial entry.
+/// Cache is optional, errors while saving just leave entry absent.
+void BuildCache::Store()
+{
+    if(iKey.empty())
+        return;
+    Dependencies = nullptr;
+    std::ostringstream os;
+    Put(os, CacheMagic);
+    Put(os, CacheVersion);
+    Put(os, (uint32_t)iDependencies.size());
+    for(auto& d: iDependencies)
+    {
+        d.iHash = HashDSO(d.iPath);
+        if(d.iHash.empty())
+            return;
+        Put(os, d.iName);
+        Put(os, d.iPath);
+        Put(os, d.iHash);
+    }
+
+    std::vector<std::string> outputs = Outputs(iArgs);
+    uint32_t count = 0;
+    for(auto& x: outputs)
+        count += !x.empty();
+    Put(os, count);
+    for(uint32_t i = 0; i < ECacheOutputs; i++)
+    {
+        if(outputs[i].empty())
+            continue;
+        if(GetFileStamp(outputs[i]).iSize < 0)
+            return;
+        MappedFile data(outputs[i].c_str());
+        Put(os, i);
+        Put(os, data.Size() ? std::string(data.Data(), data.Size()) : std::string());
+    }
+
+    if(!MakeDir(iArgs->iCache))
+        return;
+    std::string file = EntryFile();
+    std::string tmp = TempFileName(file);
+    std::ofstream fs(tmp, std::ios::binary | std::ios::trunc);
+    std::string data = os.str();
+    fs.write(data.data(), data.size());
+    fs.close();
+    if(!fs)
+    {
+        remove(tmp.c_str());
+        return;
+    }
+    if(!RenameFile(tmp, file))
+        remove(tmp.c_str());
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Cache of ArtifactBuilder results: elf2e32 --cache=<dir> ...
+//
+// Key is hash of options and contents of ELF and DEF input, their paths
+// and --libpath not counted. Import DSO known only after build, so entry
+// lists them with hashes of content and hit requires DSO of the same
+// content found at --libpath.
+// Hit restores E32 image, DSO, DEF and header instead of build.
+//
+// Image restored as is if --time set, otherwise it gets current time as
+// fresh build does and header CRC updated.
+//
+//
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <string>
+#include <vector>
+
+struct Args;
+
+/// DSO found for imports, saved in cache entry
+struct CacheDependency
+{
+    std::string iName; // as in ELF import
+    std::string iPath; // found at --libpath
+    std::string iHash;
+};
+
+class BuildCache
+{
+    public:
+        BuildCache(const Args* args);
+        ~BuildCache();
+        /// Restore outputs from cache, false on miss or when cache is off
+        bool Restore();
+        /// Save outputs of successful build
+        void Store();
+    private:
+        std::string EntryFile() const;
+    private:
+        const Args* iArgs = nullptr;
+        std::string iKey;
+        std::vector<CacheDependency> iDependencies;
+};
+
+/// Called for every DSO used by build, nothing happens without --cache
+void AddCacheDependency(const std::string& name, const std::string& path);
+
+#endif // BUILDCACHE_H
@@ -21,6 +21,7 @@
 #include <strings.h>
 
 #include "common.hpp"
+#include "logger.h"
 #include "getopt.hpp"
 #include "argparser.h"
 #include "e32common.h"
@@ -38,7 +39,8 @@ enum VerbosePrint
     ENABLE_ALL = 1,
 };
 
-static int VerboseOutput = VerbosePrint::NONE;
+// per thread to keep --verbose of batch jobs separate
+static thread_local int VerboseOutput = VerbosePrint::NONE;
 
 bool VerboseOut() {return VerboseOutput;}
 bool DisableLongVerbosePrint() {return VerboseOutput == VerbosePrint::DISABLE_LONG_PRINT;}
@@ -124,6 +126,9 @@ bool ArgParser::Parse(Args* arg) const
         return false;
     }
 
+    VerboseOutput = VerbosePrint::NONE;
+    ResetOpts();
+
     Opts op;
     for(int i = 1; i < iArgc; i++) // skip iArgv[0]
     {
@@ -220,6 +225,7 @@ bool ArgParser::Parse(Args* arg) const
                 break;
             case OptionsType::EUNCOMPRESSED:
                 arg->iCompressionMethod = KFormatNotCompressed;
+                arg->iCompressionSet = true;
                 op.binary_arg1 = KFormatNotCompressed;
                 break;
             case OptionsType::ECOMPRESSIONMETHOD:
@@ -233,6 +239,7 @@ bool ArgParser::Parse(Args* arg) const
                 else
                     arg->iCompressionMethod = KUidCompressionDeflate;
 
+                arg->iCompressionSet = true;
                 op.binary_arg1 = arg->iCompressionMethod;
                 break;
             }
@@ -246,6 +253,7 @@ bool ArgParser::Parse(Args* arg) const
                 break;
             case OptionsType::ECAPABILITY:
                 arg->iCapability = op.arg;
+                arg->iCapabilitySet = true;
                 break;
             case OptionsType::ESYSDEF:
                 arg->iSysdef = op.arg;
@@ -310,6 +318,30 @@ bool ArgParser::Parse(Args* arg) const
             case OptionsType::ELOG:
                 arg->iLog = op.arg;
                 break;
+            case OptionsType::EBATCH:
+                arg->iBatch = op.arg;
+                break;
+            case OptionsType::EJOBS:
+                arg->iJobs = strtoul(op.arg.c_str(), nullptr, 10);
+                op.binary_arg1 = arg->iJobs;
+                break;
+            case OptionsType::ESERVE:
+                arg->iServe = op.arg;
+                break;
+            case OptionsType::ECONNECT:
+                // the rest options are for daemon
+                arg->iConnect = op.arg;
+                arg->iDaemonArgs.assign(iArgv.begin() + i + 1, iArgv.end());
+                return true;
+            case OptionsType::ECACHE:
+                arg->iCache = op.arg;
+                break;
+            case OptionsType::EPROFILE:
+                arg->iProfile = op.arg;
+                break;
+            case OptionsType::EREPACK:
+                arg->iRepack = op.arg;
+                break;
             case OptionsType::EVERSION:
                 arg->iVersion = SetToolVersion(op.arg);
                 op.binary_arg1 = arg->iVersion;
@@ -361,6 +393,10 @@ bool ArgParser::Parse(Args* arg) const
                 arg->iForceE32Build = true;
                 op.binary_arg1 = true;
                 break;
+            case OptionsType::STRICTVALIDATION:
+                arg->iStrictValidation = true;
+                op.binary_arg1 = true;
+                break;
             case OptionsType::EMISSEDARG:
                 ReportError(MISSEDARGUMENT, op.name, Help);
                 return false;
@@ -403,12 +439,12 @@ bool ArgParser::Parse(Args* arg) const
     if(VerboseOutput && !DisableLongVerbosePrint())
 #endif // ELF2E32_PRINT_INPUT_ARGS
     {
-        printf("Args to parse: \n");
+        ReportLog("Args to parse: \n");
         for(int i = 0; i<iArgc; i++)
         {
-            printf("    %s\n", iArgv[i].c_str());
+            Logger::Instance()->Log("    " + iArgv[i] + "\n");
         }
-        printf("******************\n");
+        ReportLog("******************\n");
     }
     return true;
 }
@@ -441,6 +477,14 @@ const string ScreenOptions =
 "        --libpath=A semi-colon separated search path list to locate import DSOs\n"
 "        --sysdef=A semi-colon separated predefined Symbols to be exported and the ordinal number\n"
 "        --log=Redirect tool messages to file\n"
+"        --batch=Run jobs from manifest, one full set of options per line\n"
+"        --jobs=Number of worker threads for --batch and --repack, also caps threads\n"
+"               sharing work of single build, all CPU cores by default\n"
+"        --serve=Run as daemon listening at unix socket\n"
+"        --connect=Pass the rest options to daemon listening at unix socket\n"
+"        --cache=Directory to keep and reuse outputs of the same builds\n"
+"        --profile=Write phase timings and counters to file (.json for Chrome trace, text report otherwise)\n"
+"        --repack=Recompress E32Images found in directory or by file mask, --output sets directory for results\n"
 "        --messagefile=Input Message File(ignored)\n"
 "        --dumpmessagefile=Output Message File(ignored)\n"
 "        --dlldata: Allow writable static data in DLL\n"
@@ -476,6 +520,8 @@ const string ScreenOptions =
 "        --man: Describe advanced usage new features.\n"
 "        --verbose: Display the operations inside elf2e32.\n"
 "        --force: Force E32Image build. All error checks off.\n"
+"        --strictvalidation: Decompress built E32Image in full and compare it with uncompressed one.\n"
+"                            Deflate images always checked in full, bytepair ones by sample of pages.\n"
 "        --help: This command.\n"
 ;
 
@@ -15,10 +15,26 @@
 //
 //
 
+#include <atomic>
+#include <cstdio>
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <unistd.h>
 #include <algorithm>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#endif // _WIN32
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 using std::string;
 
@@ -106,25 +122,63 @@ void ReportLog(const std::string& str, int x, int y, int z)
     Logger::Instance()->Log(str, x, y, z);
 }
 
-const char* ReadFile(const char* filename, std::streamsize& fsize)
+MappedFile::MappedFile(const char* filename)
 {
-    std::fstream fs(filename, std::fstream::binary | std::fstream::in);
-    if(!fs)
+    int fd = open(filename, O_RDONLY | O_BINARY);
+    if(fd < 0)
         ReportError(FILEOPENERROR, filename);
 
-    fs.seekg(0, fs.end);
-    fsize = fs.tellg();
-    fs.seekg(0, fs.beg);
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        ReportError(FILEREADERROR, filename);
+    }
+    iSize = st.st_size;
+
+#ifndef _WIN32
+    if(iSize > 0)
+    {
+        void* p = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED)
+        {
+            close(fd);
+            iData = (char*)p;
+            iMapped = true;
+            return;
+        }
+    }
+#endif // _WIN32
 
-    char* bufferedFile = new char[fsize]();
-    fs.read(bufferedFile, fsize);
-    if(!fs)
+    iData = new char[iSize + 1]; // not null for empty file
+    std::streamsize done = 0;
+    while(done < iSize)
     {
-        delete[] bufferedFile;
+        auto n = read(fd, iData + done, iSize - done);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if(done != iSize)
+    {
+        delete[] iData;
         ReportError(FILEREADERROR, filename);
     }
-    fs.close();
-    return bufferedFile;
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if(iMapped)
+    {
+        munmap(iData, iSize);
+        return;
+    }
+#endif // _WIN32
+    delete[] iData;
 }
 
 void SaveFile(const string& filename, const string& filebuf)
@@ -149,6 +203,55 @@ bool IsFileExist(const std::string& s)
     return access(s.c_str(), 0) == 0;
 }
 
+bool MakeDir(const std::string& dir)
+{
+#ifdef _WIN32
+    int r = _mkdir(dir.c_str());
+#else
+    int r = mkdir(dir.c_str(), 0777);
+#endif // _WIN32
+    return (r == 0) || (errno == EEXIST);
+}
+
+std::string TempFileName(const std::string& file)
+{
+    static std::atomic<uint32_t> counter{0};
+    std::ostringstream name;
+    name << file << "." << getpid() << "." << counter++ << ".tmp";
+    return name.str();
+}
+
+#ifndef _WIN32
+/// rename() replaces file atomically on POSIX, so readers see old or new file
+bool RenameFile(const std::string& tmp, const std::string& file)
+{
+    return rename(tmp.c_str(), file.c_str()) == 0;
+}
+#endif // _WIN32
+
+FileStamp GetFileStamp(const std::string& s)
+{
+    FileStamp stamp;
+    struct stat st;
+    if(stat(s.c_str(), &st) != 0)
+        return stamp;
+    stamp.iSize = st.st_size;
+    stamp.iMTime = st.st_mtime;
+#if defined(__APPLE__)
+    stamp.iMTimeNs = st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+    stamp.iMTimeNs = st.st_mtim.tv_nsec;
+#endif
+    stamp.iInode = st.st_ino;
+    return stamp;
+}
+
+bool operator==(const FileStamp& left, const FileStamp& right)
+{
+    return (left.iSize == right.iSize) && (left.iMTime == right.iMTime) &&
+        (left.iMTimeNs == right.iMTimeNs) && (left.iInode == right.iInode);
+}
+
 string FileNameFromPath(const string& s)
 {
     std::size_t found = s.find_last_of("/\\");
@@ -162,3 +265,14 @@ string ToLower(const string& s)
     [](unsigned char c){ return std::tolower(c); });
     return data;
 }
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+/// rename() can't replace file on Windows
+bool RenameFile(const std::string& tmp, const std::string& file)
+{
+    return MoveFileExA(tmp.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#endif // _WIN32
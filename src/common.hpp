@@ -21,16 +21,16 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <cstdint>
+#include <ios>
+
+#include "symboltable.h"
 
 class Args;
 class Symbol;
 class E32Parser;
 class ElfParser;
 
-typedef std::list <Symbol*>	Symbols;
-/// TODO (Administrator#9#05/08/20): Use smartpointers to prevent memory leaks
-//typedef std::list <std::shared_ptr<Symbol*>> Symbols;
-
 
 enum ErrorCodes
 {
@@ -88,6 +88,14 @@ enum ErrorCodes
     ILLEGALEXPORTFROMDATASEGMENT,
     BADFILE,
     IMPORTSECTION,
+    EMPTYBATCH,
+    BATCHJOBSFAILED,
+    DAEMONERROR,
+    COMPRESSIONMISMATCH,
+    EMPTYREPACK,
+    REPACKFAILED,
+    NOSYMBOLARENA,
+    REPACKJOBFAILED,
 };
 
 // handy macro for tracing
@@ -115,12 +123,48 @@ void ReportWarning(const ErrorCodes err, const std::string& s1, const std::strin
 
 void ReportLog(const std::string& str, int x = -1, int y = -1, int z = -1);
 
-const char* ReadFile(const char* filename, std::streamsize& fsize);
+/// Whole file in memory. Memory mapped where possible, otherwise read to heap.
+/// Mapping is private: writes to Data() never reach the file.
+class MappedFile
+{
+    public:
+        MappedFile(const char* filename);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        char* Data() const {return iData;}
+        std::streamsize Size() const {return iSize;}
+    private:
+        char* iData = nullptr;
+        std::streamsize iSize = 0;
+        bool iMapped = false;
+};
+
 void SaveFile(const char* filename, const char* filebuf, int fsize);
 void SaveFile(const std::string& filename, const std::string& filebuf);
 bool IsFileExist(const std::string& filename);
+/// Create directory, true if it exists already
+bool MakeDir(const std::string& dir);
+/// Name for temporary file next to file, unique between processes and threads
+std::string TempFileName(const std::string& file);
+/// Put tmp in place of file in one step, old file kept if failed
+bool RenameFile(const std::string& tmp, const std::string& file);
+
+/// File size, modification time and inode, used to invalidate cached file data.
+/// Nanoseconds and inode catch file rewritten or replaced within the same second.
+struct FileStamp
+{
+    int64_t iSize = -1; // -1 for missed file
+    int64_t iMTime = 0;
+    int64_t iMTimeNs = 0; // 0 where stat() has seconds only
+    uint64_t iInode = 0;
+};
+bool operator==(const FileStamp& left, const FileStamp& right);
+FileStamp GetFileStamp(const std::string& filename);
 
 Symbols SymbolsFromDef(const char *defFile);
+/// Keep parsed DEF files between jobs of --batch and --serve
+void EnableDefCache();
 
 void BuildE32Image(const Args* args, const ElfParser* elfParser, const Symbols& s);
 
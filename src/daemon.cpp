@@ -0,0 +1,267 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Keep elf2e32 process warm between builds.
+//
+// Message is array of strings: uint32_t count and then uint32_t size + data
+// for every string. Request: working directory, options. Reply: frames
+// {"log", messages} sent while job prints them and final {"exit", exit code}.
+//
+// Every client served on own thread, so stalled client never blocks accept.
+// Client has ClientTimeout to send request and read replies.
+//
+//
+
+#include <mutex>
+#include <thread>
+#include <string.h>
+#include <errno.h>
+
+#include "logger.h"
+#include "daemon.h"
+#include "common.hpp"
+#include "batchrunner.h"
+#include "elf2e32_opt.hpp"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+const int ClientTimeout = 30; // seconds
+
+/// Jobs run one by one: every job changes working directory for the whole process.
+static std::mutex JobLock;
+
+bool WriteAll(int sock, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while(size)
+    {
+        ssize_t n = send(sock, p, size, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool ReadAll(int sock, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while(size)
+    {
+        ssize_t n = recv(sock, p, size, 0);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool SendStrings(int sock, const std::vector<std::string>& v)
+{
+    uint32_t count = v.size();
+    if(!WriteAll(sock, &count, sizeof(count)))
+        return false;
+    for(auto& x: v)
+    {
+        uint32_t size = x.size();
+        if(!WriteAll(sock, &size, sizeof(size)) || !WriteAll(sock, x.data(), size))
+            return false;
+    }
+    return true;
+}
+
+bool RecvStrings(int sock, std::vector<std::string>& v)
+{
+    uint32_t count = 0;
+    if(!ReadAll(sock, &count, sizeof(count)))
+        return false;
+    v.resize(count);
+    for(auto& x: v)
+    {
+        uint32_t size = 0;
+        if(!ReadAll(sock, &size, sizeof(size)))
+            return false;
+        x.resize(size);
+        if(size && !ReadAll(sock, &x[0], size))
+            return false;
+    }
+    return true;
+}
+
+int OpenSocket(const std::string& path, sockaddr_un& addr)
+{
+    if(path.size() >= sizeof(addr.sun_path))
+        ReportError(DAEMONERROR, "socket " + path, "path too long");
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(sock < 0)
+        ReportError(DAEMONERROR, "socket " + path, strerror(errno));
+    return sock;
+}
+
+std::string CurrentDir()
+{
+    std::vector<char> buf(4096);
+    while(!getcwd(buf.data(), buf.size()))
+    {
+        if(errno != ERANGE)
+            ReportError(DAEMONERROR, "getcwd", strerror(errno));
+        buf.resize(buf.size() * 2);
+    }
+    return buf.data();
+}
+#endif // _WIN32
+
+DaemonServer::DaemonServer(const Args* args): iArgs(args) {}
+
+void DaemonServer::Run()
+{
+#ifdef _WIN32
+    ReportError(DAEMONERROR, "--serve", "unix sockets unsupported on this platform");
+#else
+    sockaddr_un addr;
+    int sock = OpenSocket(iArgs->iServe, addr);
+    unlink(addr.sun_path); // left from previous run
+    if(bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0)
+        ReportError(DAEMONERROR, "bind " + iArgs->iServe, strerror(errno));
+    if(listen(sock, SOMAXCONN) < 0)
+        ReportError(DAEMONERROR, "listen " + iArgs->iServe, strerror(errno));
+
+    signal(SIGPIPE, SIG_IGN);
+    EnableDefCache();
+    Logger::Instance()->Log("elf2e32 daemon listens at " + iArgs->iServe + "\n");
+    fflush(stdout);
+    for(;;)
+    {
+        int client = accept(sock, nullptr, nullptr);
+        if(client < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            ReportError(DAEMONERROR, "accept " + iArgs->iServe, strerror(errno));
+        }
+        timeval timeout = {ClientTimeout, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        std::thread([this, client]{
+            ServeClient(client);
+            close(client);
+        }).detach();
+    }
+#endif // _WIN32
+}
+
+/// Runs on own fresh thread, thus job gets clean thread local state.
+void DaemonServer::ServeClient(int sock)
+{
+#ifndef _WIN32
+    std::vector<std::string> request;
+    if(!RecvStrings(sock, request) || request.empty())
+        return;
+
+    // client gone or stalled: job still finished, its messages dropped
+    bool connected = true;
+    OutputSink sink = [sock, &connected](const std::string& text)
+    {
+        if(connected)
+            connected = SendStrings(sock, {"log", text});
+    };
+
+    int status = 0;
+    std::lock_guard<std::mutex> lock(JobLock);
+    std::string home = CurrentDir();
+    if(chdir(request[0].c_str()) != 0)
+    {
+        sink("elf2e32: Error: Can't change directory to " + request[0] + "\n");
+        status = -FILEOPENERROR;
+    }
+    else
+    {
+        std::vector<std::string> argv(request);
+        argv[0] = "elf2e32"; // ArgParser skips argv[0]
+        for(auto& x: argv)
+        {
+            if(!x.compare(0, 7, "--serve") || !x.compare(0, 9, "--connect"))
+            {
+                sink("elf2e32: Error: Option " + x + " is not allowed for daemon job\n");
+                status = -INVALIDARGUMENT;
+            }
+        }
+        if(!status)
+            status = RunJob(argv, sink);
+    }
+    if(chdir(home.c_str()) != 0)
+        ReportWarning(DAEMONERROR, "chdir " + home, strerror(errno));
+
+    if(connected)
+        SendStrings(sock, {"exit", std::to_string(status)});
+#else
+    (void)sock;
+#endif // _WIN32
+}
+
+DaemonClient::DaemonClient(const Args* args): iArgs(args) {}
+
+void DaemonClient::Run()
+{
+#ifdef _WIN32
+    ReportError(DAEMONERROR, "--connect", "unix sockets unsupported on this platform");
+#else
+    sockaddr_un addr;
+    int sock = OpenSocket(iArgs->iConnect, addr);
+    if(connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close(sock);
+        ReportError(DAEMONERROR, "connect " + iArgs->iConnect, strerror(errno));
+    }
+
+    std::vector<std::string> request(1, CurrentDir());
+    request.insert(request.end(), iArgs->iDaemonArgs.begin(), iArgs->iDaemonArgs.end());
+    bool done = SendStrings(sock, request);
+    int status = 0;
+    std::vector<std::string> reply;
+    while(done && (done = RecvStrings(sock, reply) && (reply.size() == 2)))
+    {
+        if(reply[0] == "exit")
+        {
+            status = std::stoi(reply[1]);
+            break;
+        }
+        Logger::Instance()->Log(reply[1]);
+        fflush(stdout);
+    }
+    close(sock);
+    if(!done)
+        ReportError(DAEMONERROR, "connect " + iArgs->iConnect, "connection lost");
+
+    if(status) // message already printed by daemon
+        throw (ErrorCodes)(-status);
+#endif // _WIN32
+}
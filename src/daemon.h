@@ -0,0 +1,58 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Keep elf2e32 process warm between builds.
+//
+// Daemon:  elf2e32 --serve=/tmp/elf2e32.sock
+// Client:  elf2e32 --connect=/tmp/elf2e32.sock --elfinput=foo.dll ...
+//
+// Client sends working directory and options after --connect,
+// daemon runs them as usual elf2e32 job, streams messages back while job
+// runs and then returns exit code.
+// Parsed DEF files and import DSO indexes survive between jobs.
+//
+//
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <string>
+#include <vector>
+
+#include "task.hpp"
+
+struct Args;
+
+class DaemonServer : public Task
+{
+    public:
+        DaemonServer(const Args* args);
+        virtual ~DaemonServer() {}
+        virtual void Run() final override;
+    private:
+        void ServeClient(int sock);
+    private:
+        const Args* iArgs = nullptr;
+};
+
+class DaemonClient : public Task
+{
+    public:
+        DaemonClient(const Args* args);
+        virtual ~DaemonClient() {}
+        virtual void Run() final override;
+    private:
+        const Args* iArgs = nullptr;
+};
+
+#endif // DAEMON_H
@@ -17,6 +17,9 @@
 //
 //
 
+#include <map>
+#include <mutex>
+#include <atomic>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -135,7 +138,7 @@ void TokensChecker(const std::vector<std::string> &tokens)
   */
 void DefFile::Tokenizer(std::string aLine, size_t aIndex)
 {
-    iSymbol = new Symbol(SymbolTypeCode);
+    iSymbol = NewSymbol(SymbolTypeCode);
     iSymbol->SetSymbolStatus(SymbolStatus::Matching);
 
 //    take comments
@@ -261,8 +264,53 @@ void WriteDefString(Symbol *sym, std::fstream &fstr)
     fstr << "\n";
 }
 
+struct DefCacheEntry
+{
+    FileStamp iStamp;
+    std::unique_ptr<SymbolArena> iArena;
+    Symbols iSymbols;
+};
+
+// Parsed DEF files kept while they unchanged on disk,
+// --batch and --serve jobs often share the same DEF file.
+// Single build reads DEF once, so cache stays off there.
+static std::atomic<bool> DefCacheOn{false};
+static std::mutex DefCacheLock;
+static std::map<string, DefCacheEntry> DefCache;
+
+void EnableDefCache()
+{
+    DefCacheOn = true;
+}
+
+static Symbols CopySymbols(const Symbols& symbols, SymbolArena* arena)
+{
+    Symbols copy;
+    copy.reserve(symbols.size());
+    for(auto x: symbols)
+        copy.push_back(arena->Copy(x));
+    return copy;
+}
+
 Symbols SymbolsFromDef(const char *defFile)
 {
-	DefFile def;
-	return def.GetSymbols(defFile);
+    if(!DefCacheOn)
+    {
+        DefFile def;
+        return def.GetSymbols(defFile);
+    }
+
+    FileStamp stamp = GetFileStamp(defFile);
+    std::lock_guard<std::mutex> lock(DefCacheLock);
+    DefCacheEntry& cached = DefCache[defFile];
+    if((stamp.iSize >= 0) && (cached.iStamp == stamp))
+        return CopySymbols(cached.iSymbols, SymbolArena::Current());
+
+    DefFile def;
+    Symbols symbols = def.GetSymbols(defFile);
+
+    cached.iArena.reset(new SymbolArena());
+    cached.iSymbols = CopySymbols(symbols, cached.iArena.get());
+    cached.iStamp = stamp;
+    return symbols;
 }
@@ -41,10 +41,9 @@
 #include <string>
 #include <vector>
 
+#include "symboltable.h"
+
 class Symbol;
-typedef std::list <Symbol*>	Symbols;
-/// TODO (Administrator#9#05/08/20): Use smartpointers to prevent memory leaks
-//typedef std::list <std::shared_ptr<Symbol*>> Symbols;
 
 /**
 Class for DEF File operations.
@@ -56,6 +56,7 @@ Properties of each section:
 #include <string>
 #include <vector>
 #include "elfdefs.h"
+#include "symboltable.h"
 
 #define DEFAULT_VERSION 2
 
@@ -63,10 +64,6 @@ struct Args;
 struct Elf32_Ehdr;
 class Symbol;
 
-typedef std::list<Symbol*> Symbols;
-/// TODO (Administrator#9#05/08/20): Use smartpointers to prevent memory leaks
-//typedef std::list   <std::shared_ptr<Symbol*>> Symbols;
-
 //enum for DYN entries
 enum DYN_ENTRIES {
     DSO_DT_DSONAME=0,
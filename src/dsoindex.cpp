@@ -0,0 +1,416 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Symbol to ordinal index for import DSO.
+//
+// Index file layout, all numbers in host byte order:
+//   header: magic, version, count of DSO
+//   per DSO: name size, name, file size, mtime, mtime ns, inode,
+//            offset and size of its table
+//   tables at 4 byte aligned offsets from start of file
+// Table layout:
+//   count of symbols
+//   per symbol sorted by name: offset of name from start of table, ordinal
+//   names, zero terminated
+//
+//
+
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.hpp"
+#include "dsoindex.h"
+#include "elfparser.h"
+
+const char DSOIndexFile[] = "elf2e32_dso.idx";
+const uint32_t DSOIndexMagic = 0x49443245; // "E2DI"
+const uint32_t DSOIndexVersion = 3;
+
+struct DSOIndexEntry
+{
+    FileStamp iStamp;
+    std::shared_ptr<const DSOOrdinals> iOrdinals;
+};
+
+typedef std::map<std::string, DSOIndexEntry> DSOIndexEntries;
+
+/// Index of single libpath directory: DSO file name to its ordinals.
+/// Directory kept with trailing separator, empty for working directory.
+/// Entries of index near DSO and of index in user cache kept apart,
+/// either of them may be outdated.
+struct DSODirIndex
+{
+    DSOIndexEntries iEntries;
+    DSOIndexEntries iCached;
+    bool iChanged = false;
+};
+
+static std::mutex DSOIndexLock;
+static std::map<std::string, DSOIndexEntry> DSOIndex;
+static std::map<std::string, DSODirIndex> DSODirIndexes;
+
+static inline uint32_t Get32(const char* p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline void Set32(char* p, uint32_t x)
+{
+    memcpy(p, &x, sizeof(x));
+}
+
+DSOOrdinals::DSOOrdinals(const std::map<std::string, uint32_t>& ordinals)
+{
+    uint32_t count = ordinals.size();
+    iTable.resize(sizeof(uint32_t) + count * 2 * sizeof(uint32_t));
+    Set32(&iTable[0], count);
+    uint32_t i = 0;
+    for(auto& x: ordinals)
+    {
+        char* entry = &iTable[sizeof(uint32_t) + i++ * 2 * sizeof(uint32_t)];
+        Set32(entry, iTable.size());
+        Set32(entry + sizeof(uint32_t), x.second);
+        iTable.append(x.first.c_str(), x.first.size() + 1);
+    }
+    iData = iTable.data();
+    iSize = iTable.size();
+}
+
+DSOOrdinals::DSOOrdinals(std::shared_ptr<const MappedFile> file, const char* data, uint32_t size):
+    iFile(file), iData(data), iSize(size) {}
+
+bool DSOOrdinals::IsValid(const char* data, uint32_t size)
+{
+    if(size < sizeof(uint32_t))
+        return false;
+    uint64_t count = Get32(data);
+    if(sizeof(uint32_t) + count * 2 * sizeof(uint32_t) > size)
+        return false;
+    // every name ends inside table
+    return !count || !data[size - 1];
+}
+
+uint32_t DSOOrdinals::Ordinal(const char* symbol) const
+{
+    const char* entries = iData + sizeof(uint32_t);
+    uint32_t lo = 0, hi = Get32(iData);
+    while(lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const char* entry = entries + mid * 2 * sizeof(uint32_t);
+        uint32_t name = Get32(entry);
+        if(name >= iSize)
+            return (uint32_t)-1;
+        int r = strcmp(symbol, iData + name);
+        if(!r)
+            return Get32(entry + sizeof(uint32_t));
+        if(r < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return (uint32_t)-1;
+}
+
+/// Collect symbols reachable through DSO hash table as ElfParser::FindSymbol() does.
+std::shared_ptr<const DSOOrdinals> IndexDSO(const std::string& dso)
+{
+    ElfParser parser(dso);
+    parser.GetElfFileLayout();
+
+    std::map<std::string, uint32_t> ordinals;
+    for(uint32_t i = 0; i < parser.ImportsCount(); i++)
+    {
+        const char* name = parser.GetSymbolNameFromStringTable(i);
+        Elf32_Sym* sym = parser.FindSymbol(name);
+        if(sym != parser.GetSymbolTableEntity(i))
+            continue;
+        ordinals[name] = parser.GetSymbolOrdinal(sym);
+    }
+    return std::make_shared<DSOOrdinals>(ordinals);
+}
+
+void SplitDSOPath(const std::string& dso, std::string& dir, std::string& name)
+{
+    size_t pos = dso.find_last_of("/\\");
+    if(pos == std::string::npos)
+    {
+        dir.clear();
+        name = dso;
+        return;
+    }
+    dir = dso.substr(0, pos + 1);
+    name = dso.substr(pos + 1);
+}
+
+/// Sequential reader for index file, every read checks bounds
+class IndexReader
+{
+    public:
+        IndexReader(const char* data, size_t size): iPos(data), iEnd(data + size) {}
+        bool Get(void* data, size_t size)
+        {
+            if((size_t)(iEnd - iPos) < size)
+                return false;
+            memcpy(data, iPos, size);
+            iPos += size;
+            return true;
+        }
+        bool Get(std::string& s)
+        {
+            uint32_t size = 0;
+            if(!Get(&size, sizeof(size)) || ((size_t)(iEnd - iPos) < size))
+                return false;
+            s.assign(iPos, size);
+            iPos += size;
+            return true;
+        }
+    private:
+        const char* iPos;
+        const char* iEnd;
+};
+
+/// Index of read only directory kept in user cache directory
+/// ($XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%), named by hash of directory path.
+static std::string CacheIndexFile(const std::string& dir)
+{
+    std::string cache;
+    const char* base = getenv("XDG_CACHE_HOME");
+    if(base && *base)
+        cache = base;
+    else if((base = getenv("HOME")) && *base)
+        cache = std::string(base) + "/.cache";
+    else if((base = getenv("LOCALAPPDATA")) && *base)
+        cache = base;
+    else
+        return std::string();
+
+    std::string path = dir;
+    bool absolute = !dir.empty() && ((dir[0] == '/') || (dir[0] == '\\') || ((dir.size() > 1) && (dir[1] == ':')));
+    if(!absolute)
+    {
+        char cwd[4096];
+        if(!getcwd(cwd, sizeof(cwd)))
+            return std::string();
+        path = std::string(cwd) + "/" + dir;
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+    for(unsigned char c: path)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    std::ostringstream os;
+    os << cache << "/elf2e32/dso_" << std::hex << std::setfill('0') << std::setw(16) << hash << ".idx";
+    return os.str();
+}
+
+/// Only list of DSO parsed, tables used in mapped file.
+/// Damaged or outdated index file ignored, it will be rewritten.
+static void ReadIndexFile(const std::string& file, DSOIndexEntries& entries)
+{
+    if(file.empty() || (GetFileStamp(file).iSize <= 0))
+        return;
+    auto data = std::make_shared<const MappedFile>(file.c_str());
+    IndexReader r(data->Data(), data->Size());
+
+    uint32_t magic = 0, version = 0, count = 0;
+    if(!r.Get(&magic, sizeof(magic)) || !r.Get(&version, sizeof(version)) ||
+        (magic != DSOIndexMagic) || (version != DSOIndexVersion) || !r.Get(&count, sizeof(count)))
+        return;
+
+    DSOIndexEntries loaded;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        std::string name;
+        DSOIndexEntry entry;
+        uint32_t offset = 0, size = 0;
+        if(!r.Get(name) || !r.Get(&entry.iStamp.iSize, sizeof(entry.iStamp.iSize)) ||
+            !r.Get(&entry.iStamp.iMTime, sizeof(entry.iStamp.iMTime)) ||
+            !r.Get(&entry.iStamp.iMTimeNs, sizeof(entry.iStamp.iMTimeNs)) ||
+            !r.Get(&entry.iStamp.iInode, sizeof(entry.iStamp.iInode)) ||
+            !r.Get(&offset, sizeof(offset)) || !r.Get(&size, sizeof(size)))
+            return;
+        if(((uint64_t)offset + size > (uint64_t)data->Size()) || !DSOOrdinals::IsValid(data->Data() + offset, size))
+            return;
+        entry.iOrdinals = std::make_shared<DSOOrdinals>(data, data->Data() + offset, size);
+        loaded[name] = entry;
+    }
+    entries.swap(loaded);
+}
+
+static void LoadDSODirIndex(const std::string& dir, DSODirIndex& index)
+{
+    ReadIndexFile(dir + DSOIndexFile, index.iEntries);
+    ReadIndexFile(CacheIndexFile(dir), index.iCached);
+}
+
+template <typename T>
+void Put(std::ostream& os, const T& x)
+{
+    os.write((const char*)&x, sizeof(x));
+}
+
+void Put(std::ostream& os, const std::string& s)
+{
+    Put(os, (uint32_t)s.size());
+    os.write(s.data(), s.size());
+}
+
+static uint32_t Align4(uint32_t x)
+{
+    return (x + 3) & ~3u;
+}
+
+/// DSO indexed by other builds since load merged in, so concurrent builds
+/// keep each other's entries. Written to temporary file and renamed over
+/// old index: readers see old or new index, never partial one.
+static bool WriteIndexFile(const std::string& file, DSOIndexEntries entries)
+{
+    DSOIndexEntries saved;
+    ReadIndexFile(file, saved);
+    entries.insert(saved.begin(), saved.end()); // keeps own entries
+
+    uint32_t offset = 3 * sizeof(uint32_t);
+    for(auto& x: entries)
+        offset += sizeof(uint32_t) + x.first.size() + 4 * sizeof(int64_t) + 2 * sizeof(uint32_t);
+
+    std::ostringstream os;
+    Put(os, DSOIndexMagic);
+    Put(os, DSOIndexVersion);
+    Put(os, (uint32_t)entries.size());
+    offset = Align4(offset);
+    for(auto& x: entries)
+    {
+        Put(os, x.first);
+        Put(os, x.second.iStamp.iSize);
+        Put(os, x.second.iStamp.iMTime);
+        Put(os, x.second.iStamp.iMTimeNs);
+        Put(os, x.second.iStamp.iInode);
+        Put(os, offset);
+        Put(os, x.second.iOrdinals->Size());
+        offset = Align4(offset + x.second.iOrdinals->Size());
+    }
+    for(auto& x: entries)
+    {
+        while(os.tellp() % 4)
+            os.put(0);
+        os.write(x.second.iOrdinals->Data(), x.second.iOrdinals->Size());
+    }
+
+    std::string tmp = TempFileName(file);
+    std::ofstream fs(tmp, std::ios::binary | std::ios::trunc);
+    if(!fs)
+        return false;
+    std::string data = os.str();
+    fs.write(data.data(), data.size());
+    fs.close();
+    if(!fs || !RenameFile(tmp, file))
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// Unwritable directory (read only SDK) gets index in user cache,
+/// without that index just stays in memory.
+static void SaveDSODirIndex(const std::string& dir, const DSODirIndex& index)
+{
+    if(WriteIndexFile(dir + DSOIndexFile, index.iEntries))
+        return;
+    std::string file = CacheIndexFile(dir);
+    if(file.empty())
+        return;
+    size_t pos = file.find_last_of('/');
+    MakeDir(file.substr(0, file.find_last_of('/', pos - 1)));
+    MakeDir(file.substr(0, pos));
+    WriteIndexFile(file, index.iCached);
+}
+
+static const DSOIndexEntry* FindEntry(const DSOIndexEntries& entries, const std::string& name, const FileStamp& stamp)
+{
+    auto it = entries.find(name);
+    if((it == entries.end()) || (stamp.iSize < 0) || !(it->second.iStamp == stamp))
+        return nullptr;
+    return &it->second;
+}
+
+std::shared_ptr<const DSOOrdinals> GetDSOOrdinals(const std::string& dso)
+{
+    FileStamp stamp = GetFileStamp(dso);
+    std::string dir, name;
+    SplitDSOPath(dso, dir, name);
+    {
+        std::lock_guard<std::mutex> lock(DSOIndexLock);
+        auto it = DSOIndex.find(dso);
+        if((it != DSOIndex.end()) && (stamp.iSize >= 0) && (it->second.iStamp == stamp))
+            return it->second.iOrdinals;
+
+        auto d = DSODirIndexes.find(dir);
+        if(d == DSODirIndexes.end())
+        {
+            d = DSODirIndexes.emplace(dir, DSODirIndex()).first;
+            LoadDSODirIndex(dir, d->second);
+        }
+        const DSOIndexEntry* e = FindEntry(d->second.iEntries, name, stamp);
+        if(!e)
+            e = FindEntry(d->second.iCached, name, stamp);
+        if(e)
+        {
+            DSOIndex[dso] = *e;
+            return e->iOrdinals;
+        }
+    }
+
+    DSOIndexEntry entry;
+    entry.iStamp = stamp;
+    entry.iOrdinals = IndexDSO(dso);
+
+    std::lock_guard<std::mutex> lock(DSOIndexLock);
+    DSOIndex[dso] = entry;
+    if(stamp.iSize >= 0)
+    {
+        DSODirIndex& d = DSODirIndexes[dir];
+        d.iEntries[name] = entry;
+        d.iCached[name] = entry;
+        d.iChanged = true;
+    }
+    return entry.iOrdinals;
+}
+
+void SaveDSOIndexes()
+{
+    std::lock_guard<std::mutex> lock(DSOIndexLock);
+    for(auto& x: DSODirIndexes)
+    {
+        if(!x.second.iChanged)
+            continue;
+        SaveDSODirIndex(x.first, x.second);
+        x.second.iChanged = false;
+    }
+}
+
+uint32_t SymbolOrdinal(const DSOOrdinals& ordinals, const char* symbol)
+{
+    return ordinals.Ordinal(symbol);
+}
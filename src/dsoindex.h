@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Symbol to ordinal index for import DSO.
+// Index kept while DSO unchanged on disk, thus --batch and --serve jobs
+// parse every import library from --libpath once.
+// Also index stored in file elf2e32_dso.idx near DSO, so next runs
+// reparse only DSO changed since (size, modification time or inode differs).
+// Index file mapped and searched in place, only its list of DSO parsed.
+// Read only --libpath gets index in user cache directory instead.
+//
+//
+
+#ifndef DSOINDEX_H
+#define DSOINDEX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+class MappedFile;
+
+/// Symbols sorted by name with their ordinals, looked up by binary search.
+/// Table of index file used in mapped file, table of parsed DSO built
+/// in memory in the same layout and saved as is.
+class DSOOrdinals
+{
+    public:
+        DSOOrdinals(const std::map<std::string, uint32_t>& ordinals);
+        DSOOrdinals(std::shared_ptr<const MappedFile> file, const char* data, uint32_t size);
+        /// Same as ElfParser::GetSymbolOrdinal(): -1 for unknown symbol
+        uint32_t Ordinal(const char* symbol) const;
+        const char* Data() const {return iData;}
+        uint32_t Size() const {return iSize;}
+        /// Table layout checked once, lookups trust it
+        static bool IsValid(const char* data, uint32_t size);
+    private:
+        std::string iTable; // own table
+        std::shared_ptr<const MappedFile> iFile; // holds table of index file
+        const char* iData = nullptr;
+        uint32_t iSize = 0;
+};
+
+std::shared_ptr<const DSOOrdinals> GetDSOOrdinals(const std::string& dso);
+
+/// Write index files for directories with new or changed DSO
+void SaveDSOIndexes();
+
+/// Same as ElfParser::GetSymbolOrdinal(): -1 for unknown symbol
+uint32_t SymbolOrdinal(const DSOOrdinals& ordinals, const char* symbol);
+
+#endif // DSOINDEX_H
@@ -59,6 +59,7 @@
 #include "common.hpp"
 #include "e32editor.h"
 #include "e32parser.h"
+#include "profiler.h"
 #include "crcprocessor.h"
 #include "elf2e32_opt.hpp"
 
@@ -151,6 +152,7 @@ void CheckE32CRC(const E32Parser* parser, const Args* args)
     if(args->iFileCrc.empty()) // option --filecrc not used
         return;
 
+    ProfileScope scope("CheckE32CRC");
     E32CRCProcessor crc(parser, args);
     crc.Run();
 }
@@ -16,7 +16,9 @@
 //
 
 #include <string.h>
+#include <algorithm>
 
+#include "crc32.h"
 #include "common.hpp"
 #include "e32common.h"
 #include "e32editor.h"
@@ -28,21 +30,17 @@ E32Editor::E32Editor(const E32Parser* const file): iFile(file)
     //ctor
 }
 
+/// Single copy of decompressed image parsed in place, header keeps compression type
 void E32Editor::ConstructL()
 {
-    std::vector<char> buf(iFile->GetBufferedImage(), iFile->GetBufferedImage() + iFile->GetFileSize());
-    E32ImageHeader* h = (E32ImageHeader*)&buf[0];
+    const char* image = iFile->GetBufferedImage();
+    iImage.assign(image, image + iFile->GetFileSize());
 
-    uint32_t compression = h->iCompressionType;
-    h->iCompressionType = KFormatNotCompressed; // E32Parser already decompress E32Image
-
-    iFile = E32Parser::NewL(buf);
+    iFile = E32Parser::NewL(iImage.data(), iImage.size());
     iHeader = (E32ImageHeader*)iFile->GetE32Hdr(); //FIXME: Add explicit write access
     iHeaderV = (E32ImageHeaderV*)iFile->GetE32HdrV(); //FIXME: Add explicit write access
 
-    iHeader->iCompressionType = compression;
-
-    iE32File = iFile->GetBufferedImage();
+    iE32File = iImage.data();
 }
 
 E32Editor* E32Editor::NewL(const E32Parser* const file)
@@ -59,33 +57,39 @@ E32Editor::~E32Editor()
 
 void E32Editor::SetCaps(uint64_t caps)
 {
+    iChanged = true;
     iHeaderV->iS.iCaps = caps;
 }
 
 void E32Editor::SetFlags(uint32_t flags)
 {
+    iChanged = true;
     iHeader->iFlags = flags;
 }
 
 void E32Editor::SetHeaderCrc(uint32_t headercrc)
 {
+    iChanged = true;
     iHeader->iHeaderCrc = headercrc;
 }
 
 void E32Editor::SetCompressionType(uint32_t type)
 {
+    iChanged = true;
     if(type != (uint32_t)-1)
         iHeader->iCompressionType = type;
 }
 
 void E32Editor::SetE32Time(uint32_t timeLo, uint32_t timeHi)
 {
+    iChanged = true;
     iHeader->iTimeLo = timeLo;
     iHeader->iTimeHi = timeHi;
 }
 
 void E32Editor::SetVersion(uint8_t major, uint8_t minor, uint16_t build)
 {
+    iChanged = true;
     iHeader->iVersion.iMajor = major;
     iHeader->iVersion.iMinor = minor;
     iHeader->iVersion.iBuild = build;
@@ -93,6 +97,7 @@ void E32Editor::SetVersion(uint8_t major, uint8_t minor, uint16_t build)
 
 void E32Editor::ReGenerateCRCs()
 {
+    iChanged = true;
 	iHeader->iUidChecksum = GetUidChecksum(iHeader->iUid1, iHeader->iUid2, iHeader->iUid3);
 	iHeader->iHeaderCrc = KImageCrcInitialiser;
 	iHeader->iHeaderCrc = Crc32(iE32File, iHeader->iCodeOffset);
@@ -103,71 +108,153 @@ void E32Editor::DumpE32Img()
 //    SaveFile("tests/tmp/e32file.tmp", iFile->GetBufferedImage(), iFile->GetFileSize());
 }
 
+/// Offsets of section inside image, parts out of image dropped
+void E32Editor::SetRange(Section s, const void* begin, uint32_t size) const
+{
+    size_t imageSize = iImage.size();
+    size_t offset = std::min<size_t>((const char*)begin - iE32File, imageSize);
+    iRanges[s].iBegin = offset;
+    iRanges[s].iEnd = std::min<size_t>(offset + size, imageSize);
+    iRanges[s].iPresent = true;
+}
+
+/// The same bounds as separate checksums had, absent sections get CRC -1
+void E32Editor::FindSections() const
+{
+    for(auto& r: iRanges)
+        r = Range();
+    SetRange(EFullImage, iE32File, iImage.size());
+    SetRange(EHeader, iE32File, sizeof(E32ImageHeader) + sizeof(E32ImageHeaderJ) + sizeof(E32ImageHeaderV));
+    if(iHeaderV->iExportDescSize)
+        SetRange(EExportBitMap, iHeaderV->iExportDesc, iHeaderV->iExportDescSize);
+    SetRange(ECode, iE32File + iHeader->iCodeOffset, iHeader->iCodeSize);
+    if(iHeader->iDataSize)
+        SetRange(EData, iE32File + iHeader->iDataOffset, iHeader->iDataSize);
+    if(iHeader->iExportDirOffset)
+        SetRange(EExports, iE32File + iHeader->iExportDirOffset, iHeader->iExportDirCount * 4);
+    if(iHeader->iFlags & KImageNmdExpData)
+    {
+        const E32EpocExpSymInfoHdr* h = iFile->GetEpocExpSymInfoHdr();
+        SetRange(ESymlook, h, h->iSize);
+    }
+    const E32ImportSection* imports = iFile->GetImportSection();
+    SetRange(EImports, imports, imports->iSize);
+
+    uint32_t length = iImage.size() - iHeader->iCodeRelocOffset;
+    if(iHeader->iDataRelocOffset > 0)
+        length = iHeader->iDataRelocOffset - iHeader->iCodeRelocOffset;
+    SetRange(ECodeRelocs, iFile->GetRelocSection(iHeader->iCodeRelocOffset), length);
+    if(iHeader->iDataRelocOffset)
+    {
+        length = iImage.size() - iHeader->iDataRelocOffset;
+        SetRange(EDataRelocs, iFile->GetRelocSection(iHeader->iDataRelocOffset), length);
+    }
+}
+
+/// One pass over image: segments between section bounds checksummed in order.
+/// Segments after header kept from previous pass if bounds the same.
+void E32Editor::UpdateCRCs() const
+{
+    if(!iChanged)
+        return;
+    FindSections();
+    std::vector<uint32_t> bounds;
+    for(auto& r: iRanges)
+    {
+        if(!r.iPresent)
+            continue;
+        bounds.push_back(r.iBegin);
+        bounds.push_back(r.iEnd);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    std::vector<Segment> previous;
+    previous.swap(iSegments);
+    auto old = previous.begin();
+    for(size_t i = 1; i < bounds.size(); i++)
+    {
+        Segment s = {bounds[i - 1], bounds[i], 0};
+        while((old != previous.end()) && (old->iBegin < s.iBegin))
+            ++old;
+        if((s.iBegin >= iHeader->iCodeOffset) && (old != previous.end()) &&
+            (old->iBegin == s.iBegin) && (old->iEnd == s.iEnd))
+            s.iCrc = old->iCrc;
+        else
+            s.iCrc = Crc32(iE32File + s.iBegin, s.iEnd - s.iBegin);
+        iSegments.push_back(s);
+    }
+
+    for(int i = 0; i < ESections; i++)
+        iCRCs[i] = iRanges[i].iPresent ? RangeCrc(iRanges[i]) : (uint32_t)-1;
+    iChanged = false;
+}
+
+/// Range starts and ends at segment bounds
+uint32_t E32Editor::RangeCrc(const Range& r) const
+{
+    auto it = std::lower_bound(iSegments.begin(), iSegments.end(), r.iBegin,
+        [](const Segment& s, uint32_t offset){return s.iBegin < offset;});
+    uint32_t crc = 0;
+    for(; (it != iSegments.end()) && (it->iEnd <= r.iEnd); ++it)
+        crc = Crc32Combine(crc, it->iCrc, it->iEnd - it->iBegin);
+    return crc;
+}
+
+uint32_t E32Editor::SectionCrc(Section s) const
+{
+    UpdateCRCs();
+    return iCRCs[s];
+}
+
 uint32_t E32Editor::FullImage() const
 {
-    return Crc32(iFile->GetBufferedImage(), iFile->GetFileSize());
+    return SectionCrc(EFullImage);
 }
 
 uint32_t E32Editor::Header() const
 {
-    return Crc32(iFile->GetBufferedImage(), sizeof(E32ImageHeader) + sizeof(E32ImageHeaderJ) + sizeof(E32ImageHeaderV));
+    return SectionCrc(EHeader);
 }
 
 uint32_t E32Editor::ExportBitMap() const
 {
-    const E32ImageHeaderV* h = iFile->GetE32HdrV();
-    if(h->iExportDescSize == 0)
-        return -1;
-    return Crc32(h->iExportDesc, h->iExportDescSize);
+    return SectionCrc(EExportBitMap);
 }
 
 uint32_t E32Editor::Code() const
 {
-    return Crc32(iFile->GetBufferedImage() + iHeader->iCodeOffset, iHeader->iCodeSize);
+    return SectionCrc(ECode);
 }
 
 uint32_t E32Editor::Data() const
 {
-    if(iHeader->iDataSize == 0)
-        return -1;
-    return Crc32(iFile->GetBufferedImage() + iHeader->iDataOffset, iHeader->iDataSize);
+    return SectionCrc(EData);
 }
 
 uint32_t E32Editor::Exports() const
 {
-    if(iHeader->iExportDirOffset == 0)
-        return -1;
-    return Crc32(iFile->GetBufferedImage() + iHeader->iExportDirOffset, iHeader->iExportDirCount * 4);
+    return SectionCrc(EExports);
 }
 
 uint32_t E32Editor::Symlook() const
 {
-    if(!(iHeader->iFlags & KImageNmdExpData))
-        return -1;
-    const E32EpocExpSymInfoHdr* h = iFile->GetEpocExpSymInfoHdr();
-    return Crc32(h, h->iSize);
+    return SectionCrc(ESymlook);
 }
 
 uint32_t E32Editor::Imports() const
 {
-    const E32ImportSection* h = iFile->GetImportSection();
-    return Crc32(h, h->iSize);
+    return SectionCrc(EImports);
 }
 
 uint32_t E32Editor::CodeRelocs() const
 {
-    uint32_t length = iFile->GetFileSize() - iHeader->iCodeRelocOffset;
-    if(iHeader->iDataRelocOffset > 0)
-        length = iHeader->iDataRelocOffset - iHeader->iCodeRelocOffset;
-    return Crc32(iFile->GetRelocSection(iHeader->iCodeRelocOffset), length);
+    return SectionCrc(ECodeRelocs);
 }
 
 uint32_t E32Editor::DataRelocs() const
 {
-    if(iHeader->iDataRelocOffset == 0)
-        return -1;
-    uint32_t length = iFile->GetFileSize() - iHeader->iDataRelocOffset;
-    return Crc32(iFile->GetRelocSection(iHeader->iDataRelocOffset), length);
+    return SectionCrc(EDataRelocs);
 }
 
 uint64_t E32Editor::Caps() const
@@ -13,11 +13,16 @@
 // Description:
 // Generate checksums for the E32Image sections
 //
+// Section bounds split image to segments, every segment checksummed once
+// and section CRCs combined from them. Setters touch header only, so
+// after them only segments before code recomputed.
+//
 //
 
 #ifndef E32EDITOR_H
 #define E32EDITOR_H
 
+#include <vector>
 #include <stdint.h>
 
 class E32Parser;
@@ -61,11 +66,36 @@ class E32Editor
         uint32_t Imports() const;
         uint32_t CodeRelocs() const;
         uint32_t DataRelocs() const;
+    private:
+        enum Section {EFullImage, EHeader, EExportBitMap, ECode, EData, EExports,
+            ESymlook, EImports, ECodeRelocs, EDataRelocs, ESections};
+        struct Range
+        {
+            uint32_t iBegin = 0;
+            uint32_t iEnd = 0;
+            bool iPresent = false;
+        };
+        struct Segment
+        {
+            uint32_t iBegin;
+            uint32_t iEnd;
+            uint32_t iCrc;
+        };
+        void SetRange(Section s, const void* begin, uint32_t size) const;
+        void FindSections() const;
+        void UpdateCRCs() const;
+        uint32_t RangeCrc(const Range& r) const;
+        uint32_t SectionCrc(Section s) const;
     private:
         E32ImageHeader* iHeader = nullptr;
         E32ImageHeaderV* iHeaderV = nullptr;
         const E32Parser* iFile = nullptr;
         const char* iE32File = nullptr;
+        std::vector<char> iImage; // uncompressed copy of image being edited
+        mutable Range iRanges[ESections];
+        mutable std::vector<Segment> iSegments;
+        mutable uint32_t iCRCs[ESections] = {};
+        mutable bool iChanged = true; // header edited after CRCs computed
 };
 
 #endif // E32EDITOR_H
@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <cinttypes>
+#include <algorithm>
 
 #include "symbol.h"
 #include "e32file.h"
@@ -26,6 +27,7 @@
 #include "elfparser.h"
 #include "e32common.h"
 #include "e32parser.h"
+#include "profiler.h"
 #include "e32rebuilder.h"
 #include "e32validator.h"
 #include "e32compressor.h"
@@ -36,13 +38,39 @@
 #include "exportbitmap_section.h"
 #include "symbollookup_section.h"
 
-E32Section CodeSection(const ElfParser* parser);
-E32Section DataSection(const ElfParser* parser);
 void PrintSymlookHdr(const E32Section& s);
+uint32_t CompressedPages(const E32ImageHeader* hdr, uint32_t imageSize);
 
-bool CmpSections(const E32Section& first, const E32Section& second)
+/// Place of section in E32 image
+struct E32Chunk
 {
-    return first.type < second.type;
+    E32Sections iType;
+    const char* iInfo;
+    const char* iData;
+    size_t iSize;
+    size_t iOffset;
+};
+
+/// Sections go in E32Sections order after header. Code and data copied
+/// to image straight from ELF segments, other sections from their builders.
+static std::vector<E32Chunk> PlanLayout(const E32image& sections, const ElfParser* parser, size_t headerSize)
+{
+    std::vector<E32Chunk> r;
+    for(const auto& x: sections)
+        r.push_back(E32Chunk{x.type, x.info.c_str(), x.section.data(), x.section.size(), 0});
+    r.push_back(E32Chunk{E32Sections::CODE, "CODE", parser->CodeSegment(), parser->CodeSegmentSize(), 0});
+    if(parser->DataSegmentSize())
+        r.push_back(E32Chunk{E32Sections::DATA, "DATA", parser->DataSegment(), parser->DataSegmentSize(), 0});
+
+    std::stable_sort(r.begin(), r.end(),
+        [](const E32Chunk& a, const E32Chunk& b){ return a.iType < b.iType; });
+    size_t offset = headerSize;
+    for(auto& x: r)
+    {
+        x.iOffset = offset;
+        offset += x.iSize;
+    }
+    return r;
 }
 
 E32File::E32File(const Args* args, const ElfParser* elfParser, const Symbols& s):
@@ -78,7 +106,10 @@ void E32File::WriteE32File()
 //    iSymbols = tmp;
 
     iRelocs = new RelocsProcessor(iElfSrc, iSymbols, iE32Opts->iNamedlookup);
-    iRelocs->Process();
+    {
+        ProfileScope scope("RelocsProcessor::Process");
+        iRelocs->Process();
+    }
 
     E32HeaderSection header(iE32Opts);
     iHeader = header.MakeE32Header();
@@ -119,36 +150,40 @@ void E32File::WriteE32File()
 
     PrepareData();
 
-    for(auto x: iE32image)
+    std::vector<E32Chunk> layout = PlanLayout(iE32image, iElfSrc, iHeader.size());
+    iHeader.resize(layout.back().iOffset + layout.back().iSize);
+    hdr = (E32ImageHeader*)&iHeader[0];
+    hdrv = (E32ImageHeaderV*)&iHeader[offset];
+    for(const auto& x: layout)
     {
 // we set this field outside switch because Symbian Post Linker, Elf2E32 V2.0
 // set this field for exes as KImageHdr_ExpD_FullBitmap.
         hdrv->iExportDescType = this->iExportDescType;
-        switch(x.type)
+        switch(x.iType)
         {
         case E32Sections::HEADER:
             break;
         case E32Sections::BITMAP:
             hdrv->iExportDescSize = this->iExportDescSize;
-            hdr->iCodeOffset = iHeader.size() + x.section.size();
+            hdr->iCodeOffset = x.iOffset + x.iSize;
             break;
         case E32Sections::EXPORTS: //falltru
-            hdr->iExportDirOffset = iHeader.size() + sizeof(uint32_t); // point directly to exports
+            hdr->iExportDirOffset = x.iOffset + sizeof(uint32_t); // point directly to exports
         case E32Sections::SYMLOOK: //falltru
         case E32Sections::CODE: //falltru
-            hdr->iTextSize = hdr->iCodeSize = iHeader.size() + x.section.size() - hdr->iCodeOffset;
+            hdr->iTextSize = hdr->iCodeSize = x.iOffset + x.iSize - hdr->iCodeOffset;
             break;
         case E32Sections::DATA:
-            hdr->iDataOffset = iHeader.size();
+            hdr->iDataOffset = x.iOffset;
             break;
         case E32Sections::IMPORTS:
-            hdr->iImportOffset = iHeader.size();
+            hdr->iImportOffset = x.iOffset;
             break;
         case E32Sections::CODERELOCKS:
-            hdr->iCodeRelocOffset = iHeader.size();
+            hdr->iCodeRelocOffset = x.iOffset;
             break;
         case E32Sections::DATARELOCKS:
-            hdr->iDataRelocOffset = iHeader.size();
+            hdr->iDataRelocOffset = x.iOffset;
             break;
         default:
             ReportError(ErrorCodes::UNKNOWNSECTION);
@@ -156,14 +191,12 @@ void E32File::WriteE32File()
         }
 
         if(VerboseOut()) {
-            printf("Added Chunks has size: %06" PRIxMAX " for section:"
-               " %s at address: %08" PRIxMAX "\n",
-               (uintmax_t)x.section.size(), x.info.c_str(), (uintmax_t)iHeader.size());
+            ReportLog(std::string("Added Chunks has size: %06x for section: ") + x.iInfo +
+                      " at address: %08x\n", x.iSize, x.iOffset);
         }
 
-        iHeader.insert(iHeader.end(), x.section.begin(), x.section.end());
-        hdr = (E32ImageHeader*)&iHeader[0];
-        hdrv = (E32ImageHeaderV*)&iHeader[offset];
+        if(x.iSize)
+            memcpy(&iHeader[x.iOffset], x.iData, x.iSize);
     }
     UpdateImportTable(iHeader, iImportTabLocations, iE32Opts->iNamedlookup);
     E32ImageHeaderJ* j = (E32ImageHeaderJ*)&iHeader[sizeof(E32ImageHeader)];
@@ -172,7 +205,10 @@ void E32File::WriteE32File()
     hdr = (E32ImageHeader*)&iHeader[0];
     hdr->iCompressionType = iE32Opts->iCompressionMethod;
 
-    SetE32ImageCrc(iHeader.data());
+    {
+        ProfileScope scope("SetE32ImageCrc");
+        SetE32ImageCrc(iHeader.data());
+    }
 
     //call E32Info::HeaderInfo() for verbose output
     if(VerboseOut() && !DisableLongVerbosePrint())
@@ -186,13 +222,36 @@ void E32File::WriteE32File()
         hdr->iCompressionType = iE32Opts->iCompressionMethod;
     }
 
-    E32SectionUnit tmp = CompressE32Image(iHeader);
-    E32Parser* p = E32Parser::NewL(tmp);
-    ValidateE32Image(p);
-    delete p;
+    E32SectionUnit tmp;
+    {
+        ProfileScope scope("CompressE32Image");
+        tmp = CompressE32Image(iHeader);
+    }
+    ProfileCount("bytes in", iHeader.size());
+    ProfileCount("bytes out", tmp.size());
+    if(hdr->iCompressionType == KUidCompressionBytePair)
+        ProfileCount("pages compressed", CompressedPages(hdr, iHeader.size()));
+    {
+        ProfileScope scope("ValidateE32Image");
+        E32Parser* p = E32Parser::NewL(iHeader.data(), iHeader.size());
+        ValidateE32Image(p);
+        delete p;
+    }
+    {
+        ProfileScope scope("VerifyE32Compression");
+        VerifyE32Compression(iHeader.data(), iHeader.size(), tmp, iE32Opts->iStrictValidation);
+    }
+    ProfileScope scope("SaveFile");
     SaveFile(iE32Opts->iOutput.c_str(), tmp.data(), tmp.size());
 }
 
+/// Bytepair compression packs code and the rest of image by 4K pages
+uint32_t CompressedPages(const E32ImageHeader* hdr, uint32_t imageSize)
+{
+    uint32_t rest = imageSize - hdr->iCodeOffset - hdr->iCodeSize;
+    return (hdr->iCodeSize + 0xfff) / 0x1000 + (rest + 0xfff) / 0x1000;
+}
+
 /// Return count of exported functions or 0th ordinal
 //	RLibrary library;
 //	E32EpocExpSymInfoHdr *readHdr;
@@ -239,26 +298,6 @@ E32Section ExportSection(const Symbols& s, bool symlook, Elf32_Addr* aPlace)
     return exports;
 }
 
-E32Section CodeSection(const ElfParser* parser)
-{
-    E32Section code;
-    code.info = "CODE";
-    code.type = E32Sections::CODE;
-    code.section.insert(code.section.begin(), parser->CodeSegment(), parser->CodeSegment() + parser->CodeSegmentSize());
-    return code;
-}
-
-E32Section DataSection(const ElfParser* parser)
-{
-    E32Section data;
-    if(parser->DataSegmentSize() == 0)
-        return data;
-    data.info = "DATA";
-    data.type = E32Sections::DATA;
-    data.section.insert(data.section.begin(), parser->DataSegment(), parser->DataSegment() + parser->DataSegmentSize());
-    return data;
-}
-
 bool IsEXE(TargetType type)
 {
     if( (type == TargetType::EExe) || (type == TargetType::EExexp) ||
@@ -292,7 +331,7 @@ void E32File::PrepareData()
         if(tmp.type > E32Sections::EMPTY_SECTION)
         {
             iHeader.pop_back(); // remove E32ImageHeaderV::iExportDesc[1]
-            iE32image.push_back(tmp);
+            iE32image.push_back(std::move(tmp));
             iExportDescSize = proc->ExportDescSize();
             iExportDescType = proc->ExportDescType();
         }
@@ -302,15 +341,14 @@ void E32File::PrepareData()
 // While import section builds their relocs implicitly apply
 // for code and data sections. Therefore should run first
     ImportsSection* proc = new ImportsSection(iElfSrc, iRelocs, iE32Opts);
-    tmp = proc->Imports();
+    {
+        ProfileScope scope("ImportsSection::Imports");
+        tmp = proc->Imports();
+    }
     iImportTabLocations = proc->ImportTabLocations();
-    iE32image.push_back(tmp);
+    iE32image.push_back(std::move(tmp));
     delete proc;
 
-    tmp = CodeSection(iElfSrc);
-    if(tmp.type > E32Sections::EMPTY_SECTION)
-        iE32image.push_back(tmp);
-
     if(iE32Opts->iNamedlookup)
     {
         uint32_t r = iRelocs->DllCount();
@@ -319,22 +357,17 @@ void E32File::PrepareData()
         if(tmp.type == E32Sections::EMPTY_SECTION)
             ReportError(ErrorCodes::BADEXPORTS);
 //        PrintSymlookHdr(tmp);
-        iE32image.push_back(tmp);
+        iE32image.push_back(std::move(tmp));
         delete look;
     }
 
-    tmp = DataSection(iElfSrc);
-    if(tmp.type > E32Sections::EMPTY_SECTION)
-        iE32image.push_back(tmp);
-
     tmp = iRelocs->CodeRelocsSection();
     if(tmp.type > E32Sections::EMPTY_SECTION)
-        iE32image.push_back(tmp);
+        iE32image.push_back(std::move(tmp));
 
     tmp = iRelocs->DataRelocsSection();
     if(tmp.type > E32Sections::EMPTY_SECTION)
-        iE32image.push_back(tmp);
-    iE32image.sort([](auto A, auto B){return A.type < B.type;});
+        iE32image.push_back(std::move(tmp));
 }
 
 void BuildE32Image(const Args* args, const ElfParser* elfParser, const Symbols& s)
@@ -21,6 +21,19 @@
 #include "elf2e32_opt.hpp"
 #include "e32header_section.h"
 
+void SetE32Time(E32ImageHeader* hdr, const uint32_t time[2])
+{
+    if((time[0] > 0) && (time[1] > 0))
+    {
+        hdr->iTimeHi = time[0];
+        hdr->iTimeLo = time[1];
+        return;
+    }
+    SymbianTime t;
+    hdr->iTimeLo = t.TimeLo();
+    hdr->iTimeHi = t.TimeHi();
+}
+
 E32HeaderSection::E32HeaderSection(const Args* opts): iHeaderData(opts)
 {}
 
@@ -34,15 +47,7 @@ E32SectionUnit E32HeaderSection::MakeE32Header()
     hdr->iModuleVersion = iHeaderData->iVersion;
     hdr->iCompressionType = iHeaderData->iCompressionMethod;
 
-    SymbianTime t;
-    hdr->iTimeLo = t.TimeLo();
-    hdr->iTimeHi = t.TimeHi();
-
-    if((iHeaderData->iTime[0] > 0) && ((iHeaderData->iTime[1] > 0)))
-    {
-        hdr->iTimeHi = iHeaderData->iTime[0];
-        hdr->iTimeLo = iHeaderData->iTime[1];
-    }
+    SetE32Time(hdr, iHeaderData->iTime);
 
     E32Flags flags(iHeaderData);
     hdr->iFlags = flags.Run();
@@ -25,6 +25,7 @@
 #include "e32file.h"
 
 struct Args;
+struct E32ImageHeader;
 
 class E32HeaderSection
 {
@@ -38,4 +39,7 @@ class E32HeaderSection
         const Args* iHeaderData = nullptr;
 };
 
+/// Time from --time option if set, current time otherwise
+void SetE32Time(E32ImageHeader* hdr, const uint32_t time[2]);
+
 #endif // E32HEADERBUILDER_H
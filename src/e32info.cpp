@@ -356,7 +356,7 @@ void E32Info::CodeSection()
 void E32Info::DataSection()
 {
     printf("\nData\n");
-    PrintHexData(iE32->GetBufferedImage() + iHdr->iDataOffset, iHdr->iDataSize);
+    PrintHexData(iE32->GetBufferedImage(iHdr->iDataOffset, iHdr->iDataSize) + iHdr->iDataOffset, iHdr->iDataSize);
 
     if (iHdr->iDataRelocOffset)
     {
@@ -465,7 +465,7 @@ void E32Info::SymbolInfo()
 	if(!symInfoHdr->iDllCount)
         return;
 
-    const char *e32Buf = iE32->GetBufferedImage();
+    const char *e32Buf = (const char*)iHdr;
     // The import table orders the dependencies alphabetically...
     // We need to list out in the link order...
     printf("%d Static dependencies found\n", symInfoHdr->iDllCount);
@@ -21,26 +21,28 @@
 #include "common.hpp"
 #include "e32common.h"
 #include "e32parser.h"
-#include "symbiantime.h"
+#include "profiler.h"
 #include "e32rebuilder.h"
 #include "e32validator.h"
 #include "e32compressor.h"
 #include "elf2e32_opt.hpp"
+#include "e32header_section.h"
 #include "elf2e32_version.hpp"
 
 E32Rebuilder::E32Rebuilder(Args* param): iReBuildOptions(param) {}
 
+/// Header stored uncompressed, so unless compression changes payload copied as is
 void E32Rebuilder::Run()
 {
     iParser = E32Parser::NewL(iReBuildOptions->iE32input);
     iHdr = (E32ImageHeader*)iParser->GetE32Hdr();
-    iFileSize = iParser->GetFileSize();
-    iFile = (char*)iParser->GetBufferedImage();
+    iFileSize = iParser->IsCompressed() ? iParser->UncompressedFileSize() : iParser->GetFileSize();
 
     EditHeader();
-    E32Buf file = ReCompress();
-    SetE32ImageCrc(&file[0]);
-    SaveAndValidate(file);
+    bool recompress = iReBuildOptions->iCompressionSet &&
+        (iHdr->iCompressionType != iReBuildOptions->iCompressionMethod);
+    E32Buf file = recompress ? ReCompress() : CopyPayload();
+    SaveAndValidate(file, recompress);
 }
 
 E32Rebuilder::~E32Rebuilder()
@@ -65,9 +67,7 @@ void E32Rebuilder::EditHeader()
     iHdr->iVersion.iMinor = tool.iMinor;
     iHdr->iVersion.iBuild = tool.iBuild;
 
-    SymbianTime t;
-    iHdr->iTimeLo = t.TimeLo();
-    iHdr->iTimeHi = t.TimeHi();
+    SetE32Time(iHdr, iReBuildOptions->iTime);
 
     if(iReBuildOptions->iHeapMin || iReBuildOptions->iHeapMax)
     {
@@ -83,7 +83,7 @@ void E32Rebuilder::EditHeader()
         v->iS.iSecureId = iReBuildOptions->iSid;
     if(iReBuildOptions->iVid)
         v->iS.iVendorId = iReBuildOptions->iVid;
-    if(!iReBuildOptions->iCapability.empty())
+    if(iReBuildOptions->iCapabilitySet)
         v->iS.iCaps = ProcessCapabilities(iReBuildOptions->iCapability);
 }
 
@@ -91,19 +91,53 @@ E32Buf E32Rebuilder::ReCompress()
 {
     if(!iHdr)
         ReportError(ErrorCodes::ZEROBUFFER, __func__);
-    auto tmp = CompressE32Image(E32Buf(iFile, iFile + iFileSize));
-    iFileSize = tmp.size();
-    return tmp;
+    iFile = (char*)iParser->GetBufferedImage();
+    // compressor reads code section by header, truncated input would overrun
+    if((iHdr->iCodeOffset > iFileSize) || (iHdr->iCodeSize > iFileSize - iHdr->iCodeOffset))
+        ReportError(ErrorCodes::BADFILE, iReBuildOptions->iE32input, "code section out of file");
+    iHdr->iCompressionType = iReBuildOptions->iCompressionMethod;
+    E32ImageHeaderJ* j = (E32ImageHeaderJ*)(iFile + sizeof(E32ImageHeader));
+    j->iUncompressedSize = iFileSize - iHdr->iCodeOffset;
+    SetE32ImageCrc(iFile);
+
+    ProfileScope scope("CompressE32Image");
+    return CompressE32Image(E32Buf(iFile, iFile + iFileSize));
 }
 
-void E32Rebuilder::SaveAndValidate(const E32Buf& e32File)
+/// Edited header followed by code and the rest of image as stored in input file
+E32Buf E32Rebuilder::CopyPayload()
 {
-    delete iParser;
-    iParser = nullptr;
-    iParser = E32Parser::NewL(e32File);
+    if(!iHdr)
+        ReportError(ErrorCodes::ZEROBUFFER, __func__);
+    SetE32ImageCrc((char*)iHdr);
+
+    ProfileScope scope("CopyPayload");
+    const char* stored = iParser->GetStoredImage();
+    E32Buf file;
+    file.reserve(iParser->GetStoredSize());
+    file.insert(file.end(), (char*)iHdr, (char*)iHdr + iHdr->iCodeOffset);
+    file.insert(file.end(), stored + iHdr->iCodeOffset, stored + iParser->GetStoredSize());
+    return file;
+}
 
+/// Output parsed as E32Info would do, only parts checks touch get decoded
+void E32Rebuilder::SaveAndValidate(const E32Buf& e32File, bool recompressed)
+{
+    E32Parser* out = E32Parser::NewL(e32File);
     if(iReBuildOptions->iForceE32Build == false) // can't build invalid E32Image while validate on
-        ValidateE32Image(iParser);
-    CheckE32CRC(iParser, iReBuildOptions);
-    SaveFile(iReBuildOptions->iOutput.c_str(), e32File.data(), iFileSize);
+    {
+        {
+            ProfileScope scope("ValidateE32Image");
+            ValidateE32Image(out);
+        }
+        if(recompressed)
+        {
+            ProfileScope scope("VerifyE32Compression");
+            VerifyE32Compression(iFile, iFileSize, e32File, iReBuildOptions->iStrictValidation);
+        }
+    }
+    CheckE32CRC(out, iReBuildOptions);
+    delete out;
+    ProfileScope scope("SaveFile");
+    SaveFile(iReBuildOptions->iOutput.c_str(), e32File.data(), e32File.size());
 }
@@ -34,7 +34,8 @@ class E32Rebuilder: public Task
 	private:
 		void EditHeader();
 		E32Buf ReCompress();
-		void SaveAndValidate(const E32Buf& e32);
+		E32Buf CopyPayload();
+		void SaveAndValidate(const E32Buf& e32, bool recompressed);
 	private:
 		E32Parser* iParser = nullptr;
 		Args* iReBuildOptions = nullptr;
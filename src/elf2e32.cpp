@@ -22,6 +22,11 @@
 #include "elf2e32.h"
 #include "e32common.h"
 #include "dsocrcfile.h"
+#include "daemon.h"
+#include "profiler.h"
+#include "symboltable.h"
+#include "batchrunner.h"
+#include "repackrunner.h"
 #include "e32rebuilder.h"
 #include "elf2e32_opt.hpp"
 #include "artifactbuilder.h"
@@ -36,17 +41,41 @@ void SetCmdParamAtCompileTime(Args* param)
     #endif //SET_COMPILETIME_LOAD_EXISTED_FILECRC
 }
 
+/// Name of output or input for profile track
+static std::string ProfileTrackName(const Args* param)
+{
+    if(!param->iOutput.empty())
+        return param->iOutput;
+    if(!param->iDso.empty())
+        return param->iDso;
+    if(!param->iBatch.empty())
+        return param->iBatch;
+    if(!param->iRepack.empty())
+        return param->iRepack;
+    if(!param->iE32input.empty())
+        return param->iE32input;
+    return param->iElfinput;
+}
+
 Elf2E32::Elf2E32(int argc, char** argv)
 {
     iArgParser = new ArgParser(argc, argv);
     iCmdParam = new Args();
 }
 
+Elf2E32::Elf2E32(const std::vector<std::string>& argv)
+{
+    iArgParser = new ArgParser(argv);
+    iCmdParam = new Args();
+}
+
 Elf2E32::~Elf2E32()
 {
     delete iArgParser;
     delete iCmdParam;
     delete iTask;
+    delete iSymbolArena;
+    delete iProfiler; // writes profile
 }
 
 void Elf2E32::Run()
@@ -57,7 +86,25 @@ void Elf2E32::Run()
     SetCmdParamAtCompileTime(iCmdParam);
 
     Logger::Instance(iCmdParam->iLog);
-    if(!iCmdParam->iE32input.empty() && iCmdParam->iOutput.empty())
+    if(!iCmdParam->iProfile.empty())
+        iProfiler = new Profiler(iCmdParam->iProfile, ProfileTrackName(iCmdParam));
+    // symbols of job freed with it
+    iSymbolArena = new SymbolArena();
+    iSymbolArena->Attach();
+
+    if(!iCmdParam->iConnect.empty())
+        iTask = new DaemonClient(iCmdParam);
+
+    else if(!iCmdParam->iServe.empty())
+        iTask = new DaemonServer(iCmdParam);
+
+    else if(!iCmdParam->iBatch.empty())
+        iTask = new BatchRunner(iCmdParam);
+
+    else if(!iCmdParam->iRepack.empty())
+        iTask = new RepackRunner(iCmdParam);
+
+    else if(!iCmdParam->iE32input.empty() && iCmdParam->iOutput.empty())
         iTask = new E32Info(iCmdParam);
 
     else if(!iCmdParam->iE32input.empty() && !iCmdParam->iOutput.empty())
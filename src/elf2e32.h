@@ -18,15 +18,21 @@
 #ifndef ELF2E32_H
 #define ELF2E32_H
 
+#include <vector>
+#include <string>
+
 struct Args;
 class Task;
 class ArgParser;
+class Profiler;
+class SymbolArena;
 struct E32ImageHeader;
 
 class Elf2E32
 {
     public:
         Elf2E32(int argc, char** argv);
+        Elf2E32(const std::vector<std::string>& argv);
         Elf2E32(const Elf2E32&) = delete;
         ~Elf2E32();
         void Run();
@@ -35,6 +41,8 @@ class Elf2E32
         ArgParser* iArgParser = nullptr;
         Args* iCmdParam = nullptr;
         Task* iTask = nullptr;
+        Profiler* iProfiler = nullptr;
+        SymbolArena* iSymbolArena = nullptr;
 };
 
 #endif // ELF2E32_H
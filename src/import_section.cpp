@@ -26,8 +26,10 @@
 #include <vector>
 
 #include "elfdefs.h"
-#include "e32parser.h"
+#include "dsoindex.h"
+#include "buildcache.h"
 #include "elfparser.h"
+#include "profiler.h"
 #include "elf2e32_opt.hpp"
 #include "import_section.h"
 #include "relocsprocessor.h"
@@ -64,19 +66,22 @@ void ImportsSection::AllocStringTable()
         iStrTab.push_back(0);
 }
 
-string ImportsSection::FindDSO(const string& name)
+string FindDSOAtLibpath(const string& name, const string& libpath, string* lastTried)
 {
-	if(IsFileExist(name))
-		return name;
+    if(IsFileExist(name))
+        return name;
 
-	string paths = iOpts->iLibpath;
-	string aDSOPath;
-	size_t end = 0, start = 0;
-	while(end != std::string::npos)
+    string aDSOPath = name;
+    size_t start = 0;
+    while(start < libpath.size())
     {
-        end = paths.find_first_of(";");
-        aDSOPath = paths.substr(start, end);
-        start = end;
+        size_t end = libpath.find(';', start);
+        if(end == std::string::npos)
+            end = libpath.size();
+        aDSOPath = libpath.substr(start, end - start);
+        start = end + 1;
+        if(aDSOPath.empty())
+            continue;
         size_t s = aDSOPath.find_first_of("\\");
         if(s != std::string::npos)
             aDSOPath += "\\";
@@ -84,15 +89,27 @@ string ImportsSection::FindDSO(const string& name)
             aDSOPath += "/";
         aDSOPath += name;
 
-		if(IsFileExist(aDSOPath))
-			return aDSOPath;
+        if(IsFileExist(aDSOPath))
+            return aDSOPath;
     }
-	ReportError(ErrorCodes::FILEOPENERROR, aDSOPath);
-	return string(); //silence gcc warning
+    if(lastTried)
+        *lastTried = aDSOPath;
+    return string();
+}
+
+string ImportsSection::FindDSO(const string& name)
+{
+    string lastTried;
+    string dso = FindDSOAtLibpath(name, iOpts->iLibpath, &lastTried);
+    if(dso.empty())
+        ReportError(ErrorCodes::FILEOPENERROR, lastTried);
+    AddCacheDependency(name, dso);
+    return dso;
 }
 
 E32Section ImportsSection::Imports()
 {
+    ProfileCount("imported DLLs", iRelocs->DllCount());
     AllocStringTable();
 // We calculate count bytes without vla parts(E32ImportBlock::iImports[])
     size_t importSectionSize = sizeof(/*E32ImportSection*/ int32_t) +
@@ -121,12 +138,11 @@ E32Section ImportsSection::Imports()
 		aImportSection.push_back(nImports); // E32ImportBlock::iNumberOfImports
 
         string aDSO = FindDSO(imports[0].iSOName);
-		ElfParser parser(aDSO);
-		parser.GetElfFileLayout();
+        auto ordinals = GetDSOOrdinals(aDSO);
 		for(const auto& aReloc: imports)
         {
             const char* aSymName = iElf->GetSymbolNameFromStringTable(aReloc.iSymNdx);
-            uint32_t aOrdinal = parser.GetSymbolOrdinal(aSymName);
+            uint32_t aOrdinal = SymbolOrdinal(*ordinals, aSymName);
 
 //check the reloc refers to Code Segment
             Elf32_Addr r_offset = aReloc.iRela.r_offset;
@@ -146,6 +162,7 @@ E32Section ImportsSection::Imports()
 		}
 		idx++;
     }
+    SaveDSOIndexes();
 
     if((importSectionSize != aImportSection.size() * sizeof(Elf32_Word)) && !iOpts->iForceE32Build)
         ReportError(ErrorCodes::IMPORTSECTION, importSectionSize, aImportSection.size() * sizeof(Elf32_Word));
@@ -176,23 +193,23 @@ vector<int32_t> ImportsSection::ImportTabLocations()
  *        offSet += sizeof(uint32_t);
  *    }
  */
-void UpdateImportTable(const E32SectionUnit& s, const std::vector<int32_t>& iImportTabLocations, bool iSNamedlookup)
+void UpdateImportTable(E32SectionUnit& s, const std::vector<int32_t>& iImportTabLocations, bool iSNamedlookup)
 {
     if(!iSNamedlookup)
         return;
-    E32Parser* p = E32Parser::NewL(s);
-    const E32ImageHeader* h = p->GetE32Hdr();
-    const E32EpocExpSymInfoHdr* sInf = p->GetEpocExpSymInfoHdr();
-    size_t offSet = p->ExpSymInfoTableOffset();
+    const E32ImageHeader* h = (const E32ImageHeader*)s.data();
+    if(!(h->iFlags & KImageNmdExpData))
+        ReportError(ErrorCodes::ZEROBUFFER, "Call GetEpocExpSymInfoHdr() on target without named lookup section");
+    // E32EpocExpSymInfoHdr follows export table
+    size_t offSet = h->iExportDirOffset + h->iExportDirCount * sizeof(uint32_t);
+    const E32EpocExpSymInfoHdr* sInf = (const E32EpocExpSymInfoHdr*)&s[offSet];
     offSet += sInf->iDepDllZeroOrdTableOffset; // This points to the ordinal zero offset table now
     offSet -= h->iCodeOffset; // Starts from code section
 
-    uint32_t* aImportTab = (uint32_t*)p->GetImportSection();
+    uint32_t* aImportTab = (uint32_t*)&s[h->iImportOffset];
     for(auto x: iImportTabLocations)
     {
         aImportTab[x] = offSet;
         offSet += sizeof(uint32_t);
     }
-    s.assign(p->GetBufferedImage(), p->GetBufferedImage() + p->GetFileSize());
-    delete p;
 }
@@ -70,6 +70,11 @@ class ImportsSection
         bool iNamedLookUp = false;
 };
 
-void UpdateImportTable(const E32SectionUnit& s, const std::vector<int32_t>& iImportTabLocations, bool iSNamedlookup);
+void UpdateImportTable(E32SectionUnit& s, const std::vector<int32_t>& iImportTabLocations, bool iSNamedlookup);
+
+/// Search DSO at working directory and then at --libpath. Empty string if not found,
+/// lastTried gets last checked path.
+std::string FindDSOAtLibpath(const std::string& name, const std::string& libpath,
+                             std::string* lastTried = nullptr);
 
 #endif // IMPORTPROCESSOR_H
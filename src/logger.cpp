@@ -17,9 +17,13 @@
 //
 
 #include <stdio.h>
+#include <stdarg.h>
 #include "logger.h"
 
-static Logger* _self = nullptr;
+// Every thread has own logger. Thus messages from the batch jobs never mixed.
+static thread_local Logger* _self = nullptr;
+static thread_local std::string* _capture = nullptr;
+static thread_local const OutputSink* _sink = nullptr;
 
 struct Message
 {
@@ -89,10 +93,19 @@ struct Message Messages[]=
     {ErrorCodes::ILLEGALEXPORTFROMDATASEGMENT, "'%s' : '%s' Import relocation does not refer to code segment.\n"},
     {ErrorCodes::BADFILE, "File %s has %s.\n"},
     {ErrorCodes::IMPORTSECTION, "Failed to create import section! Expected: %d, have: %d\n"},
+    {ErrorCodes::EMPTYBATCH, "Batch manifest %s has no jobs.\n"},
+    {ErrorCodes::BATCHJOBSFAILED, "%d batch job(s) failed.\n"},
+    {ErrorCodes::DAEMONERROR, "Daemon: %s failed: %s.\n"},
+    {ErrorCodes::COMPRESSIONMISMATCH, "Compressed E32Image differs from built one in %s.\n"},
+    {ErrorCodes::EMPTYREPACK, "No E32Images found at %s.\n"},
+    {ErrorCodes::REPACKFAILED, "%d E32Image(s) failed to repack.\n"},
+    {ErrorCodes::NOSYMBOLARENA, "Symbol created without SymbolArena attached to thread.\n"},
+    {ErrorCodes::REPACKJOBFAILED, "Repack of %s failed with code %d.\n"},
 //    {ErrorCodes::, ".\n"}//,
 };
 
-Logger::Logger(const std::string& s)
+Logger::Logger(const std::string& s, std::string* capture, const OutputSink* sink):
+    iCapture(capture), iSink(sink)
 {
     if(s.empty())
         return;
@@ -115,78 +128,118 @@ Logger::~Logger()
 Logger* Logger::Instance(const std::string& s)
 {
     if(!_self)
-        _self = new Logger(s);
+        _self = new Logger(s, _capture, _sink);
     return _self;
 }
 
-void Logger::Log(const std::string& s)
+/// Store messages for the current thread in out instead of print them to console.
+/// Drops the current thread logger, so next job may set own log file.
+/// Pass nullptr to restore console output.
+void Logger::CaptureOutput(std::string* out)
+{
+    delete _self;
+    _self = nullptr;
+    _capture = out;
+}
+
+/// Pass messages for the current thread to sink instead of print them to console.
+/// Drops the current thread logger same as CaptureOutput().
+/// Pass nullptr to restore console output.
+void Logger::StreamOutput(const OutputSink* sink)
 {
+    delete _self;
+    _self = nullptr;
+    _sink = sink;
+}
+
+static void AppendFormatted(std::string& out, const char* fmt, va_list ap)
+{
+    va_list aq;
+    va_copy(aq, ap);
+    int len = vsnprintf(nullptr, 0, fmt, aq);
+    va_end(aq);
+    if(len > 0)
+    {
+        size_t pos = out.size();
+        out.resize(pos + len + 1);
+        vsnprintf(&out[pos], len + 1, fmt, ap);
+        out.resize(pos + len);
+    }
+}
+
+void Logger::Write(const char* fmt, ...)
+{
+    va_list ap;
     if(iFile)
-        fprintf(iFile, "%s", s.c_str());
-    printf("%s", s.c_str());
+    {
+        va_start(ap, fmt);
+        vfprintf(iFile, fmt, ap);
+        va_end(ap);
+    }
+
+    va_start(ap, fmt);
+    if(iCapture)
+        AppendFormatted(*iCapture, fmt, ap);
+    else if(iSink)
+    {
+        std::string text;
+        AppendFormatted(text, fmt, ap);
+        if(!text.empty())
+            (*iSink)(text);
+    }
+    else
+        vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void Logger::Log(const std::string& s)
+{
+    Write("%s", s.c_str());
 }
 
 void Logger::Log(const std::string& s, int x)
 {
-    if(iFile)
-        fprintf(iFile, s.c_str(), x);
-    printf(s.c_str(), x);
+    Write(s.c_str(), x);
 }
 
 void Logger::Log(const std::string& s, int x, int y)
 {
-    if(iFile)
-        fprintf(iFile, s.c_str(), x, y);
-    printf(s.c_str(), x, y);
+    Write(s.c_str(), x, y);
 }
 
 void Logger::Log(const std::string& s, int x, int y, int z)
 {
-    if(iFile)
-        fprintf(iFile, s.c_str(), x, y, z);
-    printf(s.c_str(), x, y, z);
+    Write(s.c_str(), x, y, z);
 }
 
 void Logger::Log(ErrorCodes errcode, const std::string& s)
 {
-    if(iFile)
-        fprintf(iFile, Messages[errcode].str, s.c_str());
-    printf(Messages[errcode].str, s.c_str());
+    Write(Messages[errcode].str, s.c_str());
 }
 
 
 void Logger::Log(ErrorCodes errcode, const std::string& s1, const std::string& s)
 {
-    if(iFile)
-        fprintf(iFile, Messages[errcode].str, s1.c_str(), s.c_str());
-    printf(Messages[errcode].str, s1.c_str(), s.c_str());
+    Write(Messages[errcode].str, s1.c_str(), s.c_str());
 }
 
 void Logger::Log(ErrorCodes errcode, const std::string& s1, int x, const std::string& s2)
 {
-    if(iFile)
-        fprintf(iFile, Messages[errcode].str, s1.c_str(), x, s2.c_str());
-    printf(Messages[errcode].str, s1.c_str(), x, s2.c_str());
+    Write(Messages[errcode].str, s1.c_str(), x, s2.c_str());
 }
 
 
 void Logger::Log(ErrorCodes errcode)
 {
-    if(iFile)
-        fprintf(iFile, "%s", Messages[errcode].str);
-    printf("%s", Messages[errcode].str);
+    Write("%s", Messages[errcode].str);
 }
 
 void Logger::Log(ErrorCodes errcode, int x, int y)
 {
-    if(iFile)
-        fprintf(iFile, Messages[errcode].str, x, y);
-    printf(Messages[errcode].str, x, y);
+    Write(Messages[errcode].str, x, y);
 }
 
 void Logger::Log(ErrorCodes errcode, int x)
 {
-    if(iFile)
-        fprintf(iFile, Messages[errcode].str, x);
-    printf(Messages[errcode].str, x);
+    Write(Messages[errcode].str, x);
 }
@@ -21,12 +21,18 @@
 
 #include <string>
 #include <stdio.h>
+#include <functional>
 #include "common.hpp"
 
+/// Receives every message of thread as soon as it printed
+typedef std::function<void(const std::string&)> OutputSink;
+
 class Logger
 {
     public:
         static Logger* Instance(const std::string& s = empty);
+        static void CaptureOutput(std::string* out);
+        static void StreamOutput(const OutputSink* sink);
         ~Logger();
         void Log(const std::string& s);
         void Log(const std::string& s, int x);
@@ -43,11 +49,14 @@ class Logger
         void Log(ErrorCodes errcode, int x, int y);
         void Log(ErrorCodes errcode, int x, int y, int z);
     private:
-        Logger(const std::string& s);
+        Logger(const std::string& s, std::string* capture, const OutputSink* sink);
         Logger(const Logger&) = delete;
         Logger& operator=(const Logger&) = delete;
+        void Write(const char* fmt, ...);
     private:
         FILE* iFile = nullptr;
+        std::string* iCapture = nullptr;
+        const OutputSink* iSink = nullptr;
 };
 
 #endif // LOGGER_H
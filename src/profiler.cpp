@@ -0,0 +1,247 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Phase timings and counters.
+//
+//
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "common.hpp"
+#include "profiler.h"
+
+/// Profiler and track of calling thread, previous state restored on detach
+struct ProfileState
+{
+    Profiler* iProfiler = nullptr;
+    int iTrack = 0;
+    int iDepth = 0;
+    ProfileState* iPrev = nullptr;
+};
+
+static thread_local ProfileState* CurrentState = nullptr;
+
+static void Attach(Profiler* profiler, int track)
+{
+    ProfileState* s = new ProfileState();
+    s->iProfiler = profiler;
+    s->iTrack = track;
+    s->iPrev = CurrentState;
+    CurrentState = s;
+}
+
+static void Detach()
+{
+    ProfileState* s = CurrentState;
+    CurrentState = s->iPrev;
+    delete s;
+}
+
+Profiler::Profiler(const std::string& file, const std::string& trackName):
+    iFile(file), iStart(std::chrono::steady_clock::now())
+{
+    AddTrack(0, trackName);
+    Attach(this, 0);
+}
+
+Profiler::~Profiler()
+{
+    Detach();
+    bool json = (iFile.size() > 5) && !iFile.compare(iFile.size() - 5, 5, ".json");
+    std::string data = json ? TraceJson() : TextReport();
+    std::ofstream fs(iFile, std::ios::binary | std::ios::trunc);
+    fs.write(data.data(), data.size());
+    fs.close();
+    if(!fs)
+        ReportWarning(FILEOPENERROR, iFile);
+}
+
+Profiler* Profiler::Current()
+{
+    return CurrentState ? CurrentState->iProfiler : nullptr;
+}
+
+void Profiler::AddTrack(int track, const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(iMutex);
+    iTracks[track] = name;
+}
+
+void Profiler::AddEvent(const ProfileEvent& e)
+{
+    std::lock_guard<std::mutex> lock(iMutex);
+    iEvents.push_back(e);
+}
+
+int64_t Profiler::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - iStart).count();
+}
+
+static std::string JsonString(const std::string& s)
+{
+    std::string r = "\"";
+    for(char c: s)
+    {
+        if(c == '"' || c == '\\')
+            r += '\\';
+        if((unsigned char)c < ' ')
+            c = ' ';
+        r += c;
+    }
+    return r + "\"";
+}
+
+/// Chrome trace event format, times in microseconds
+std::string Profiler::TraceJson() const
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"elf2e32\"}}";
+    for(auto& x: iTracks)
+    {
+        os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << x.first <<
+            ",\"args\":{\"name\":" << JsonString(x.second) << "}}";
+    }
+    for(auto& e: iEvents)
+    {
+        os << ",\n{\"name\":" << JsonString(e.iName) << ",\"pid\":1,\"tid\":" << e.iTrack <<
+            ",\"ts\":" << e.iStart / 1000.0;
+        if(e.iCounter)
+            os << ",\"ph\":\"C\",\"args\":{\"value\":" << e.iValue << "}}";
+        else
+            os << ",\"ph\":\"X\",\"dur\":" << e.iValue / 1000.0 << "}";
+    }
+    os << "\n]}\n";
+    return os.str();
+}
+
+struct PhaseTotal
+{
+    int64_t iTime = 0;
+    int iCalls = 0;
+};
+
+/// Phases of every track in order of start with nesting shown by indent,
+/// then counters. Totals over all tracks added for multi-job runs.
+std::string Profiler::TextReport() const
+{
+    std::vector<ProfileEvent> events(iEvents);
+    std::stable_sort(events.begin(), events.end(),
+        [](const ProfileEvent& a, const ProfileEvent& b)
+        {
+            if(a.iTrack != b.iTrack)
+                return a.iTrack < b.iTrack;
+            if(a.iStart != b.iStart)
+                return a.iStart < b.iStart;
+            return a.iDepth < b.iDepth;
+        });
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    std::map<std::string, PhaseTotal> phases;
+    std::map<std::string, int64_t> counters;
+    size_t i = 0;
+    for(auto& t: iTracks)
+    {
+        std::map<std::string, int64_t> trackCounters;
+        os << "Track " << t.first << ": " << t.second << "\n";
+        for(; i < events.size() && events[i].iTrack == t.first; i++)
+        {
+            const ProfileEvent& e = events[i];
+            if(e.iCounter)
+            {
+                trackCounters[e.iName] += e.iValue;
+                counters[e.iName] += e.iValue;
+                continue;
+            }
+            std::string name = std::string(e.iDepth * 2 + 4, ' ') + e.iName;
+            os << std::left << std::setw(40) << name << std::right << std::setw(12) << e.iValue / 1e6 << " ms\n";
+            phases[e.iName].iTime += e.iValue;
+            phases[e.iName].iCalls++;
+        }
+        for(auto& c: trackCounters)
+            os << "    " << std::left << std::setw(36) << c.first << std::right << std::setw(12) << c.second << "\n";
+        os << "\n";
+    }
+
+    if(iTracks.size() < 2)
+        return os.str();
+    os << "Total:\n";
+    for(auto& p: phases)
+    {
+        os << "    " << std::left << std::setw(36) << p.first << std::right << std::setw(12) <<
+            p.second.iTime / 1e6 << " ms" << std::setw(8) << p.second.iCalls << " calls\n";
+    }
+    for(auto& c: counters)
+        os << "    " << std::left << std::setw(36) << c.first << std::right << std::setw(12) << c.second << "\n";
+    return os.str();
+}
+
+ProfileTrack::ProfileTrack(Profiler* profiler, int track, const std::string& name)
+{
+    if(!profiler)
+        return;
+    profiler->AddTrack(track, name);
+    Attach(profiler, track);
+    iAttached = true;
+}
+
+ProfileTrack::~ProfileTrack()
+{
+    if(iAttached)
+        Detach();
+}
+
+ProfileScope::ProfileScope(const char* name): iName(name)
+{
+    if(!CurrentState)
+        return;
+    iStart = CurrentState->iProfiler->Now();
+    CurrentState->iDepth++;
+    iActive = true;
+}
+
+ProfileScope::~ProfileScope()
+{
+    if(!iActive)
+        return;
+    ProfileState* s = CurrentState;
+    s->iDepth--;
+    ProfileEvent e;
+    e.iName = iName;
+    e.iTrack = s->iTrack;
+    e.iDepth = s->iDepth;
+    e.iStart = iStart;
+    e.iValue = s->iProfiler->Now() - iStart;
+    s->iProfiler->AddEvent(e);
+}
+
+void ProfileCount(const char* name, int64_t value)
+{
+    if(!CurrentState)
+        return;
+    ProfileEvent e;
+    e.iName = name;
+    e.iTrack = CurrentState->iTrack;
+    e.iDepth = CurrentState->iDepth;
+    e.iCounter = true;
+    e.iStart = CurrentState->iProfiler->Now();
+    e.iValue = value;
+    CurrentState->iProfiler->AddEvent(e);
+}
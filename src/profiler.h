@@ -0,0 +1,92 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Phase timings and counters: elf2e32 --profile=<file> ...
+//
+// File with .json extension gets Chrome trace events (open it with
+// chrome://tracing or ui.perfetto.dev), other files get text report.
+// Every thread records to profiler attached to it, so --batch jobs
+// appear as separate tracks. Without --profile scope only checks
+// thread local pointer.
+//
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+struct ProfileEvent
+{
+    const char* iName = nullptr;
+    int iTrack = 0;
+    int iDepth = 0;
+    bool iCounter = false;
+    int64_t iStart = 0; // ns since profiler created
+    int64_t iValue = 0; // duration in ns or counter value
+};
+
+class Profiler
+{
+    public:
+        /// Attach calling thread as track 0
+        Profiler(const std::string& file, const std::string& trackName);
+        /// Detach and write file
+        ~Profiler();
+        void AddTrack(int track, const std::string& name);
+        void AddEvent(const ProfileEvent& e);
+        int64_t Now() const;
+        /// Profiler of calling thread or nullptr
+        static Profiler* Current();
+    private:
+        std::string TraceJson() const;
+        std::string TextReport() const;
+    private:
+        std::string iFile;
+        std::chrono::steady_clock::time_point iStart;
+        std::mutex iMutex;
+        std::vector<ProfileEvent> iEvents;
+        std::map<int, std::string> iTracks;
+};
+
+/// Record events of calling thread to profiler as given track, nothing if profiler is null
+class ProfileTrack
+{
+    public:
+        ProfileTrack(Profiler* profiler, int track, const std::string& name);
+        ~ProfileTrack();
+    private:
+        bool iAttached = false;
+};
+
+/// Measure time from construction to end of scope
+class ProfileScope
+{
+    public:
+        ProfileScope(const char* name);
+        ~ProfileScope();
+    private:
+        const char* iName;
+        int64_t iStart = 0;
+        bool iActive = false;
+};
+
+/// Add value to counter of current track
+void ProfileCount(const char* name, int64_t value);
+
+#endif // PROFILER_H
@@ -29,6 +29,8 @@
 #include "elfdefs.h"
 #include "e32common.h"
 #include "elfparser.h"
+#include "profiler.h"
+#include "workerpool.h"
 #include "relocsprocessor.h"
 #include "symbolprocessor.h"
 #include "e32importsprocessor.hpp"
@@ -48,15 +50,153 @@ inline T Align(T v)
 	return (T)res;
 }
 
-bool Cmp(const LocalReloc& x, const LocalReloc& y)
+void LocalRelocs::Add(Elf32_Addr offset, uint16_t relocType, Elf32_Addr segmentBase, const char* srcname)
 {
-	return x.iRela.r_offset < y.iRela.r_offset;
+    if(iOffsets.empty() || (offset < iMinOffset))
+    {
+        iMinOffset = offset;
+        iBase = segmentBase;
+    }
+    iOffsets.push_back(offset);
+    iRelocTypes.push_back(relocType);
+    if(iIndexed)
+        iIndex.insert(offset);
+#if EXPLORE_RELOCS_PROCESSING
+    iSources.push_back(srcname);
+#else
+    (void)srcname;
+#endif // EXPLORE_RELOCS_PROCESSING
+}
+
+void LocalRelocs::AddDiagnostic(const RelocDiagnostic& d)
+{
+    iDiagnostics.push_back(d);
+    iDiagnostics.back().iPos = iOffsets.size() - 1;
+}
+
+bool LocalRelocs::Contains(Elf32_Addr offset)
+{
+    if(!iIndexed)
+    {
+        iIndex.insert(iOffsets.begin(), iOffsets.end());
+        iIndexed = true;
+    }
+    return iIndex.count(offset) > 0;
+}
+
+/// Stable counting sort of positions by key in range [0, buckets)
+template <class Key>
+static std::vector<uint32_t> CountingSort(const std::vector<uint32_t>& positions, size_t buckets, Key key)
+{
+    std::vector<uint32_t> first(buckets + 1);
+    for(auto x: positions)
+        first[key(x) + 1]++;
+    for(size_t i = 1; i < buckets; i++)
+        first[i] += first[i - 1];
+    std::vector<uint32_t> r(positions.size());
+    for(auto x: positions)
+        r[first[key(x)]++] = x;
+    return r;
+}
+
+/// Radix sort: by 12-bit offset in page, then by page. Both passes are
+/// stable, so equal offsets keep their order. Sorted relocs split to pages
+/// for E32RelocBlock.
+void LocalRelocs::Sort()
+{
+    size_t count = iOffsets.size();
+    iPages.clear();
+    if(!count)
+        return;
+
+    Elf32_Addr low = *std::min_element(iOffsets.begin(), iOffsets.end()) & 0xfffff000;
+    Elf32_Addr high = *std::max_element(iOffsets.begin(), iOffsets.end()) & 0xfffff000;
+    std::vector<uint32_t> order(count);
+    for(size_t i = 0; i < count; i++)
+        order[i] = i;
+    order = CountingSort(order, 0x1000,
+        [this](uint32_t pos){ return iOffsets[pos] & 0xfff; });
+    order = CountingSort(order, ((high - low) >> 12) + 1,
+        [this, low](uint32_t pos){ return (iOffsets[pos] - low) >> 12; });
+
+    std::vector<Elf32_Addr> offsets(count);
+    std::vector<uint16_t> relocTypes(count);
+    std::vector<uint32_t> positions(iDiagnostics.empty() ? 0 : count);
+#if EXPLORE_RELOCS_PROCESSING
+    std::vector<const char*> sources(count);
+#endif // EXPLORE_RELOCS_PROCESSING
+    for(size_t i = 0; i < count; i++)
+    {
+        uint32_t pos = order[i];
+        offsets[i] = iOffsets[pos];
+        relocTypes[i] = iRelocTypes[pos];
+        if(!positions.empty())
+            positions[pos] = i;
+#if EXPLORE_RELOCS_PROCESSING
+        sources[i] = iSources[pos];
+#endif // EXPLORE_RELOCS_PROCESSING
+        uint32_t page = offsets[i] & 0xfffff000;
+        if(iPages.empty() || (iPages.back().iPage != page))
+            iPages.push_back(RelocPage{page, (uint32_t)i, 0});
+        iPages.back().iCount++;
+    }
+    iOffsets.swap(offsets);
+    iRelocTypes.swap(relocTypes);
+#if EXPLORE_RELOCS_PROCESSING
+    iSources.swap(sources);
+#endif // EXPLORE_RELOCS_PROCESSING
+
+    for(auto& x: iDiagnostics)
+        x.iPos = positions[x.iPos];
+    std::sort(iDiagnostics.begin(), iDiagnostics.end(),
+        [](const RelocDiagnostic& a, const RelocDiagnostic& b){ return a.iPos < b.iPos; });
+}
+
+size_t LocalRelocs::Size() const
+{
+    return iOffsets.size();
+}
+
+Elf32_Addr LocalRelocs::Offset(size_t i) const
+{
+    return iOffsets[i];
+}
+
+uint16_t LocalRelocs::RelocType(size_t i) const
+{
+    return iRelocTypes[i];
+}
+
+const char* LocalRelocs::Source(size_t i) const
+{
+#if EXPLORE_RELOCS_PROCESSING
+    return iSources[i];
+#else
+    (void)i;
+    return "unknown";
+#endif // EXPLORE_RELOCS_PROCESSING
+}
+
+/// Address of segment for reloc with the lowest offset
+Elf32_Addr LocalRelocs::Base() const
+{
+    return iBase;
+}
+
+const std::vector<RelocDiagnostic>& LocalRelocs::Diagnostics() const
+{
+    return iDiagnostics;
+}
+
+const std::vector<RelocPage>& LocalRelocs::Pages() const
+{
+    return iPages;
 }
 
 void RelocsProcessor::SortRelocs()
 {
-    std::sort(iCodeRelocations.begin(), iCodeRelocations.end(), Cmp);
-    std::sort(iDataRelocations.begin(), iDataRelocations.end(), Cmp);
+    iCodeRelocations.Sort();
+    iDataRelocations.Sort();
 }
 
 RelocsProcessor::RelocsProcessor(const ElfParser* elf, const Symbols& s, bool symlook):
@@ -66,18 +206,14 @@ void RelocsProcessor::Process()
 {
     ProcessVerInfo();
     iVersionTbl = iElf->VersionTbl();
-    std::vector<RelocBlock> r = iElf->GetRelocs();
-    for(const auto& x: r)
-    {
-        if(x.rel)
-            ProcessRelocations(x.rel, x);
-        else
-            ProcessRelocations(x.rela, x);
-    }
+    ProcessRelocations(iElf->GetRelocs());
     RelocsFromSymbols(); //CreateExportTable()
     ProcessSymbolInfo(); //ProcessSymbolInfo()
     ProcessVeneers();
     SortRelocs();
+    ProfileCount("code relocations", iCodeRelocations.Size());
+    ProfileCount("data relocations", iDataRelocations.Size());
+    ProfileCount("import relocations", iImportsCount);
 }
 
 bool ValidRelocEntry(uint8_t aType)
@@ -97,27 +233,6 @@ bool ValidRelocEntry(uint8_t aType)
     }
 }
 
-size_t RelocationsSize(const std::vector<LocalReloc>& relocs)
-{
-    size_t bytecount = 0;
-    int page = -1;
-    for(const auto& x: relocs)
-    {
-        int p = x.iRela.r_offset & 0xfffff000;
-        if (page != p)
-        {
-            if (bytecount%4 != 0)
-                bytecount += sizeof(uint16_t);
-            bytecount += E32RelocSectionStatic; // page, block size
-            page = p;
-        }
-        bytecount += sizeof(uint16_t);
-    }
-    if (bytecount%4 != 0)
-        bytecount += sizeof(uint16_t);
-    return bytecount;
-}
-
 void RelocsProcessor::RelocsFromSymbols()
 {
 #if EXPLORE_RELOCS_PROCESSING
@@ -171,133 +286,92 @@ void RelocsProcessor::ProcessSymbolInfo()
 
 void RelocsProcessor::ProcessVeneers()
 {
-    int length = strlen("$Ven$AT$L$$");
-    Elf32_Sym* symTab = iElf->SymTab();
-    const char* strTab = iElf->StrTab();
-    if (!(symTab && strTab))
-        return;
     // Process the symbol table to find Long ARM to Thumb Veneers
     // i.e. symbols of the form '$Ven$AT$L$$'
-    for(; symTab < iElf->Lim(); symTab++)
+    for(Elf32_Sym* aSym: iElf->LookupStaticSymbols("$Ven$AT$L$$"))
     {
-        if (!symTab->st_name) continue;
-        const char* aSymName = strTab + symTab->st_name;
-        Elf32_Sym* aSym;
-
-        if (!strncmp(aSymName, "$Ven$AT$L$$", length))
-        {
-            aSym = symTab;
-            Elf32_Addr r_offset = aSym->st_value;
-            const Elf32_Addr aOffset = r_offset + 4;
-            Elf32_Word	aInstruction = iElf->GetRelocationValue(r_offset);
-            bool aRelocEntryFound = false;
-
-            for(const auto& x: iCodeRelocations)
-            {
-                // Check if there is a relocation entry for the veneer symbol
-                if (x.iRela.r_offset == aOffset)
-                {
-                    aRelocEntryFound = true;
-                    break;
-                }
-            }
-            Elf32_Word aPointer = iElf->GetRelocationValue(aOffset);
-
-            /* If the symbol addresses a Thumb instruction, its value is the
-             * address of the instruction with bit zero set (in a
-             * relocatable object, the section offset with bit zero set).
-             * This allows a linker to distinguish ARM and Thumb code symbols
-             * without having to refer to the map. An ARM symbol will always have
-             * an even value, while a Thumb symbol will always have an odd value.
-             * Reference: Section 4.5.3 in Elf for the ARM Architecture Doc
-             * aIsThumbSymbol will be 1 for a thumb symbol and 0 for ARM symbol
-             */
-            int aIsThumbSymbol = aPointer & 0x1;
-
-            /* The relocation entry should be generated for the veneer only if
-             * the following three conditions are satisfied:
-             * 1) Check if the instruction at the symbol is as expected
-             *    i.e. has the bit pattern 0xe51ff004 == 'LDR pc,[pc,#-4]'
-             * 2) There is no relocation entry generated for the veneer symbol
-             * 3) The instruction in the location provided by the pointer is a thumb symbol
-             */
-            if (aInstruction == 0xE51FF004 && !aRelocEntryFound && aIsThumbSymbol)
-                AddToLocalRelocations(aOffset, 0, R_ARM_NONE, aSym, "veneers", false, true);
-        }
+        Elf32_Addr r_offset = aSym->st_value;
+        const Elf32_Addr aOffset = r_offset + 4;
+        Elf32_Word	aInstruction = iElf->GetRelocationValue(r_offset);
+        // Check if there is a relocation entry for the veneer symbol
+        bool aRelocEntryFound = HasCodeRelocation(aOffset);
+        Elf32_Word aPointer = iElf->GetRelocationValue(aOffset);
+
+        /* If the symbol addresses a Thumb instruction, its value is the
+         * address of the instruction with bit zero set (in a
+         * relocatable object, the section offset with bit zero set).
+         * This allows a linker to distinguish ARM and Thumb code symbols
+         * without having to refer to the map. An ARM symbol will always have
+         * an even value, while a Thumb symbol will always have an odd value.
+         * Reference: Section 4.5.3 in Elf for the ARM Architecture Doc
+         * aIsThumbSymbol will be 1 for a thumb symbol and 0 for ARM symbol
+         */
+        int aIsThumbSymbol = aPointer & 0x1;
+
+        /* The relocation entry should be generated for the veneer only if
+         * the following three conditions are satisfied:
+         * 1) Check if the instruction at the symbol is as expected
+         *    i.e. has the bit pattern 0xe51ff004 == 'LDR pc,[pc,#-4]'
+         * 2) There is no relocation entry generated for the veneer symbol
+         * 3) The instruction in the location provided by the pointer is a thumb symbol
+         */
+        if (aInstruction == 0xE51FF004 && !aRelocEntryFound && aIsThumbSymbol)
+            AddToLocalRelocations(aOffset, 0, R_ARM_NONE, aSym, "veneers", false, true);
     }
 }
 
 /**
 This function creates Code and Data relocations from the corresponding
-ELF form to E32 form.
+ELF form to E32 form. Relocs should be sorted: every page becomes
+E32RelocBlock with entries copied in order.
 */
-E32Section CreateRelocations(const std::vector<LocalReloc>& aRelocations, E32Section& aRelocs, RelocsProcessor* rp)
+E32Section CreateRelocations(const LocalRelocs& aRelocations, E32Section& aRelocs, RelocsProcessor* rp)
 {
-	size_t rsize = RelocationsSize(aRelocations);
-	if(!rsize)
+    const std::vector<RelocPage>& pages = aRelocations.Pages();
+    if(pages.empty())
         return E32Section();
 
-    size_t aRelocsSize = Align(rsize + E32RelocSectionStatic);
-    aRelocs.section.insert(aRelocs.section.begin(), aRelocsSize, 0);
+    size_t rsize = 0;
+    for(const auto& x: pages)
+        rsize += E32RelocSectionStatic + Align(x.iCount * sizeof(uint16_t)); // page, block size, entries
+    aRelocs.section.insert(aRelocs.section.begin(), rsize + E32RelocSectionStatic, 0);
 
     E32RelocSection* section = (E32RelocSection*)&aRelocs.section[0];
     section->iSize = rsize;
-    section->iNumberOfRelocs = aRelocations.size();
+    section->iNumberOfRelocs = aRelocations.Size();
 
 #if EXPLORE_RELOCS_PROCESSING
     std::stringstream relnfo;
     relnfo << std::hex << "E32RelocSection size: " << section->iSize << "\n";
     relnfo << std::hex << "Number Of Relocs: " << section->iNumberOfRelocs << "\n";
-    relnfo << std::hex << "ElfRel entry | E32Rel entry | relfrom | function name: \n";
+    relnfo << std::hex << "ElfRel entry | E32Rel entry | relfrom: \n";
 #endif // EXPLORE_RELOCS_PROCESSING
 
-    E32RelocBlock* block = section->iRelocBlock;
-    // data should point to iEntry field, set later.
-    uint16_t* data = (uint16_t*)section->iRelocBlock;
-
-    const uint32_t aBase = (*aRelocations.begin()).iSegment->p_vaddr;
-    int page = -1;
-    int pagesize = sizeof(E32RelocSectionStatic);
-    for (auto r: aRelocations)
+    const uint32_t aBase = aRelocations.Base();
+    const std::vector<RelocDiagnostic>& diagnostics = aRelocations.Diagnostics();
+    auto diagnostic = diagnostics.begin();
+    char* block = (char*)section->iRelocBlock;
+    for(const auto& page: pages)
     {
-        int p = r.iRela.r_offset & 0xfffff000;
-        r.iIntermediates.iPage = p;
-        if (page != p)
+        E32RelocBlock* b = (E32RelocBlock*)block;
+        b->iPageOffset = page.iPage - aBase;
+        b->iBlockSize = E32RelocSectionStatic + Align(page.iCount * sizeof(uint16_t));
+        uint16_t* data = b->iEntry;
+        for(size_t i = page.iFirst; i < page.iFirst + page.iCount; i++)
         {
-            if(pagesize%4 != 0)
-            {
-                // at first run does nothing
-                *data++ = 0;
-                pagesize += sizeof(uint16_t);
+            *data++ = (uint16_t)((aRelocations.Offset(i) & 0xfff) | aRelocations.RelocType(i));
+            if((diagnostic != diagnostics.end()) && (diagnostic->iPos == i))
+                rp->ValidateLocalReloc(*diagnostic++, aRelocs.info);
 #if EXPLORE_RELOCS_PROCESSING
-                relnfo << std::hex << "Zero padding page\n";
+            relnfo << std::hex << std::setw(12) << aRelocations.Offset(i) << " |" << std::setw(13) <<
+                data[-1] << " |" << std::setw(8) << aRelocations.Source(i) << "\n";
 #endif // EXPLORE_RELOCS_PROCESSING
-            }
-            if (page == -1) page = p;
-            block->iPageOffset = page - aBase;
-            block->iBlockSize = pagesize;
-
-#if EXPLORE_RELOCS_PROCESSING
-            relnfo << std::hex << "Reloc Page Offset: " << block->iPageOffset << "\n";
-            relnfo << std::hex << "Reloc Block Size: " << block->iBlockSize << "\n";
-#endif // EXPLORE_RELOCS_PROCESSING
-
-            pagesize = E32RelocSectionStatic;
-            page = p;
-            block = (E32RelocBlock*)data;
-            data = block->iEntry; // now data points to iEntry field
         }
-        uint16_t relocType = rp->Fixup(r.iSymbol);
-        *data++ = (uint16_t)((r.iRela.r_offset & 0xfff) | relocType);
-        pagesize += sizeof(uint16_t);
-
-        r.iIntermediates.iRelocType = relocType;
-        r.iIntermediates.iE32Reloc = (uint16_t)((r.iRela.r_offset & 0xfff) | relocType);
-        rp->ValidateLocalReloc(r, aRelocs.info);
 #if EXPLORE_RELOCS_PROCESSING
-        relnfo << std::hex << std::setw(12) << r.iRela.r_offset << " |" << std::setw(13) << r.iIntermediates.iE32Reloc <<
-                " |" << std::setw(8) << r.iIntermediates.iType << " | " << r.iIntermediates.iSymbolName << "\n";
+        relnfo << std::hex << "Reloc Page Offset: " << b->iPageOffset << "\n";
+        relnfo << std::hex << "Reloc Block Size: " << b->iBlockSize << "\n";
 #endif // EXPLORE_RELOCS_PROCESSING
+        block += b->iBlockSize; // padding entry already zero
     }
 
     if(aRelocs.info == "CODERELOCKS")
@@ -307,35 +381,22 @@ E32Section CreateRelocations(const std::vector<LocalReloc>& aRelocations, E32Sec
     else
         ReportError(ErrorCodes::UNKNOWNERROR);
 
-    if (pagesize%4 != 0)
-    {
-        *data++ = 0;
-        pagesize += sizeof(uint16_t);
-#if EXPLORE_RELOCS_PROCESSING
-        relnfo << std::hex << "Zero padding section\n";
-#endif // EXPLORE_RELOCS_PROCESSING
-    }
-    block->iPageOffset = page - aBase;
-    block->iBlockSize = pagesize;
 #if EXPLORE_RELOCS_PROCESSING
-    relnfo << "After padding\n";
-    relnfo << std::hex << "Reloc Page Offset: " << block->iPageOffset << "\n";
-    relnfo << std::hex << "Reloc Block Size: " << block->iBlockSize << "\n";
-
     if(aRelocs.info == "CODERELOCKS")
         SaveFile("tests/tmp/relocsreport.txt", relnfo.str());
 #endif // EXPLORE_RELOCS_PROCESSING
     return aRelocs;
 }
 
-void RelocsProcessor::ValidateLocalReloc(const LocalReloc& r,
+void RelocsProcessor::ValidateLocalReloc(const RelocDiagnostic& r,
                     const string& name)
 {
-    uint32_t entryType = r.iIntermediates.iE32Reloc & 0xf000;
+    uint16_t e32Reloc = (uint16_t)((r.iOffset & 0xfff) | r.iRelocType);
+    uint32_t entryType = e32Reloc & 0xf000;
 //    ReportLog("\nentry type: %d E32 reloc: %d E32 reloc type: %d\n", entryType,
-//              r.iIntermediates.iE32Reloc, r.iIntermediates.iRelocType);
+//              e32Reloc, r.iRelocType);
 
-    if(!r.iSymbol && (strcmp(r.iIntermediates.iType, "sym lookup\0") != 0) )
+    if(!r.iSymbol && (strcmp(r.iType, "sym lookup\0") != 0) )
         ReportLog("Elf symbol not found for symbol: " + name + "!\n");
 //    else {
 //        ReportLog("Elf symbol ST_BIND: %d\n", ELF32_ST_BIND(r.iSymbol->st_info) );
@@ -357,7 +418,7 @@ void RelocsProcessor::ValidateLocalReloc(const LocalReloc& r,
 
         ReportLog(name + " has ");
         ReportLog("bad entry type: %d E32 reloc: %d E32 reloc type: %d\n", entryType,
-              r.iIntermediates.iE32Reloc, r.iIntermediates.iRelocType);
+              e32Reloc, r.iRelocType);
 
         if(tmp)
             ReportLog(std::string("with symbol name: %s\n") + tmp + "\n");
@@ -382,8 +443,7 @@ void RelocsProcessor::PrintBadRelocs(const std::string& type, const BadRelocs& r
         ReportLog("\n");
         ReportLog("r_off : E32Rel : RelType : iPage");
         for(auto r: x.second) {
-            uint16_t relocType = Fixup(r.iSymbol);
-            uint16_t t = (uint16_t)((r.iRela.r_offset & 0xfff) | relocType);
+            uint16_t t = (uint16_t)((r.iOffset & 0xfff) | r.iRelocType);
 //            uint32_t entryType = t & 0xf000;
             ReportLog(" %d\t", t);
         }
@@ -391,55 +451,118 @@ void RelocsProcessor::PrintBadRelocs(const std::string& type, const BadRelocs& r
     ReportLog("\n*******************\n");
 }
 
-bool IsLocalReloc(const LocalReloc& rel)
-{
-    return ((rel.iHasRela && !rel.iVeneerSymbol) &&
-            (rel.iRelType == R_ARM_ABS32 || rel.iRelType == R_ARM_GLOB_DAT));
-}
-
-uint16_t RelocsProcessor::Fixup(const Elf32_Sym* s)
+uint16_t RelocsProcessor::Fixup(const Elf32_Sym* s) const
 {
 	if(s)
 		return iElf->Segment(s);
     return KTextRelocType;
 }
 
-void RelocsProcessor::ApplyLocalReloc(const LocalReloc& rel)
+void RelocsProcessor::ApplyLocalReloc(Elf32_Addr offset, const Elf32_Sym* sym)
 {
-	if(IsLocalReloc(rel))
-	{
-        Elf32_Word* aLoc = iElf->GetRelocationPlace(rel.iRela.r_offset);
-        aLoc[0] += rel.iSymbol->st_value;
-	}
+    Elf32_Word* aLoc = iElf->GetRelocationPlace(offset);
+    aLoc[0] += sym->st_value;
+}
+
+const uint32_t KRelocsInChunk = 16 * 1024;
+// fewer relocs classified by caller faster than handed to pool
+const uint32_t KMinParallelRelocs = 2 * KRelocsInChunk;
+
+/// Part of RelocBlock classified by one worker
+struct RelocChunk
+{
+    const RelocBlock* iBlock;
+    uint32_t iFirst;
+    uint32_t iCount;
+    std::vector<ClassifiedReloc> iRelocs;
+};
+
+/// Chunks classified by shared worker pool, they only read ELF. Then relocs applied
+/// and added in chunk order as by serial walk, so imports and relocs order
+/// doesn't depend on threads count.
+void RelocsProcessor::ProcessRelocations(const std::vector<RelocBlock>& blocks)
+{
+    std::vector<RelocChunk> chunks;
+    uint32_t total = 0;
+    for(const auto& x: blocks)
+    {
+        if(!x.rel && !x.rela)
+            continue;
+        uint32_t count = x.size / (x.rel ? sizeof(Elf32_Rel) : sizeof(Elf32_Rela));
+        total += count;
+        for(uint32_t first = 0; first < count; first += KRelocsInChunk)
+            chunks.push_back(RelocChunk{&x, first, std::min(KRelocsInChunk, count - first), {}});
+    }
+
+    auto classify = [&](uint32_t i)
+    {
+        if(chunks[i].iBlock->rel)
+            ClassifyRelocations(chunks[i].iBlock->rel, chunks[i]);
+        else
+            ClassifyRelocations(chunks[i].iBlock->rela, chunks[i]);
+    };
+    if(total < KMinParallelRelocs)
+    {
+        for(uint32_t i = 0; i < chunks.size(); i++)
+            classify(i);
+    }
+    else
+        ParallelFor(chunks.size(), 2, classify);
+
+    for(const auto& x: chunks)
+    {
+        if(x.iBlock->rel)
+            MergeRelocations(x.iBlock->rel, x);
+        else
+            MergeRelocations(x.iBlock->rela, x);
+    }
 }
 
 template <class T>
-void RelocsProcessor::ProcessRelocations(const T* elfRel, const RelocBlock& r)
+void RelocsProcessor::ClassifyRelocations(const T* elfRel, RelocChunk& c) const
 {
-	if(!elfRel)
-		return;
+    c.iRelocs.reserve(c.iCount);
+    for(uint32_t i = c.iFirst; i < c.iFirst + c.iCount; i++)
+    {
+        uint8_t aType = ELF32_R_TYPE(elfRel[i].r_info);
+        if(!ValidRelocEntry(aType))
+            continue;
+        ClassifiedReloc r;
+        r.iEntry = i;
+        r.iSymNdx = ELF32_R_SYM(elfRel[i].r_info);
+        r.iRelType = aType;
+        r.iOffset = elfRel[i].r_offset;
+        r.iImported = IsImportedSymbol(r.iSymNdx, iElf);
+        if(!r.iImported)
+        {
+            r.iSymbol = iElf->GetSymbolTableEntity(r.iSymNdx);
+            r.iSegmentType = iElf->SegmentType(r.iOffset);
+            r.iSegment = iElf->GetSegmentAtAddr(r.iOffset);
+            r.iRelocType = Fixup(r.iSymbol);
+        }
+        c.iRelocs.push_back(r);
+    }
+}
 
-	T* elfRelLimit = ELF_ENTRY_PTR(T, elfRel, r.size);
-	while(elfRel < elfRelLimit)
+/// Addend read here: local relocs applied before may change it
+template <class T>
+void RelocsProcessor::MergeRelocations(const T* elfRel, const RelocChunk& c)
+{
+    for(const auto& x: c.iRelocs)
     {
-		uint8_t aType = ELF32_R_TYPE(elfRel->r_info );
-		if(ValidRelocEntry(aType))
+        if(!x.iImported)
         {
-			uint32_t aSymIdx = ELF32_R_SYM(elfRel->r_info);
-            Elf32_Rela tmp;
-            tmp.r_offset = elfRel->r_offset;
-            tmp.r_info = elfRel->r_info;
-            tmp.r_addend = iElf->Addend(elfRel);
-			if(IsImportedSymbol(aSymIdx, iElf))
-			{
-			    iImportsCount++;
-                AddToImports(aSymIdx, tmp);
-			}
-			else
-                AddToLocalRelocations(aSymIdx, aType, tmp, r.type);
-		}
-		elfRel++;
-	}
+            AddToLocalRelocations(x, c.iBlock->type);
+            continue;
+        }
+        const T* r = elfRel + x.iEntry;
+        Elf32_Rela tmp;
+        tmp.r_offset = r->r_offset;
+        tmp.r_info = r->r_info;
+        tmp.r_addend = iElf->Addend(r);
+        iImportsCount++;
+        AddToImports(x.iSymNdx, tmp);
+    }
 }
 
 void RelocsProcessor::AddToImports(uint32_t index, Elf32_Rela rela)
@@ -456,59 +579,62 @@ void RelocsProcessor::AddToImports(uint32_t index, Elf32_Rela rela)
                 } );
 }
 
-void RelocsProcessor::AddToLocalRelocations(uint32_t index,
-                     uint8_t relType, Elf32_Rela rela, const char* srcname)
+void RelocsProcessor::AddToLocalRelocations(const ClassifiedReloc& r, const char* srcname)
 {
-    LocalReloc loc;
-    loc.iSegment = iElf->GetSegmentAtAddr(rela.r_offset);
-    loc.iSymNdx = index;
-    loc.iRela = Elf32_Rela(rela);
-    loc.iHasRela = true;
-    loc.iRelType = relType;
-    loc.iSymbol = iElf->GetSymbolTableEntity(index);
-    loc.iSegmentType = iElf->SegmentType(rela.r_offset);
-    loc.iIntermediates.iSymbolName = iElf->GetSymbolNameFromStringTable(index);
-    loc.iIntermediates.iType = srcname;
-    SortReloc(loc);
+    if(r.iRelType == R_ARM_ABS32 || r.iRelType == R_ARM_GLOB_DAT)
+        ApplyLocalReloc(r.iOffset, r.iSymbol);
+    SortReloc(r.iSegmentType, r.iOffset, r.iSegment, r.iSymNdx, r.iSymbol, r.iRelocType, srcname);
 }
 
 //Elf32_Word aAddend = Addend(aElfRel);
 //tmp.r_addend = iElf->Addend(elfRel);
 //aAddr = tmp.r_offset
 void RelocsProcessor::AddToLocalRelocations(uint32_t aAddr, uint32_t index,
-            uint8_t relType, Elf32_Sym* aSym, const char* srcname, bool aDelSym, bool veneerSymbol)
-{
-    LocalReloc loc;
-    uint16_t type = Fixup(aSym);
-    loc.iSegment = iElf->Segment(type);
-    loc.iSymNdx = index;
-    loc.iRela.r_offset = aAddr;
-    loc.iHasRela = false;
-    loc.iSymbol = aSym;
-    loc.iRelType = relType;
-    loc.iDelSym = aDelSym; // true for absent symbols only
-    loc.iVeneerSymbol = veneerSymbol;
-    loc.iSegmentType = ESegmentType::ESegmentRO;
+            uint8_t /*relType*/, Elf32_Sym* aSym, const char* srcname, bool /*aDelSym*/, bool /*veneerSymbol*/)
+{
+    // relocs without Elf32_Rela and veneers not applied, relType, aDelSym and
+    // veneerSymbol left for diagnostics.
 // If absent symbols present we out of export table range
-//    loc.iIntermediates.iSymbolName = iElf->GetSymbolNameFromStringTable(index);
-    loc.iIntermediates.iType = srcname;
-    SortReloc(loc);
+    uint16_t relocType = Fixup(aSym);
+    SortReloc(ESegmentType::ESegmentRO, aAddr, iElf->Segment(relocType), index, aSym, relocType, srcname);
 }
 
-void RelocsProcessor::SortReloc(const LocalReloc& r)
+void RelocsProcessor::SortReloc(ESegmentType segmentType, Elf32_Addr offset, const Elf32_Phdr* segment,
+                uint32_t index, Elf32_Sym* sym, uint16_t relocType, const char* srcname)
 {
-    ApplyLocalReloc(r);
-    switch(r.iSegmentType)
+    LocalRelocs* relocs = nullptr;
+    switch(segmentType)
     {
     case ESegmentType::ESegmentRO:
-        iCodeRelocations.push_back(r);
+        relocs = &iCodeRelocations;
         break;
     case ESegmentType::ESegmentRW:
-        iDataRelocations.push_back(r);
+        relocs = &iDataRelocations;
         break;
     default:
-        break;
+        return;
     }
+
+    relocs->Add(offset, relocType, segment ? segment->p_vaddr : 0, srcname);
+
+    uint32_t entryType = relocType & 0xf000;
+    bool badEntry = (entryType != KTextRelocType) && (entryType != KDataRelocType) &&
+            (entryType != KInferredRelocType);
+    if((!sym && strcmp(srcname, "sym lookup")) || badEntry)
+    {
+        RelocDiagnostic d;
+        d.iOffset = offset;
+        d.iSymNdx = index;
+        d.iSymbol = sym;
+        d.iRelocType = relocType;
+        d.iType = srcname;
+        relocs->AddDiagnostic(d);
+    }
+}
+
+bool RelocsProcessor::HasCodeRelocation(Elf32_Addr offset)
+{
+    return iCodeRelocations.Contains(offset);
 }
 
 void RelocsProcessor::ProcessVerInfo()
@@ -33,6 +33,9 @@
 // 2. Exported symbols
 // 3. Symbol lookup table (optional)
 //
+// Local relocs stored as offsets and E32 reloc types only, symbol details
+// saved just for relocs failed validation.
+//
 
 #ifndef RELOCSPROCESSOR_H
 #define RELOCSPROCESSOR_H
@@ -40,11 +43,13 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <unordered_set>
 #include "e32file.h"
 #include "artifactbuilder.h"
 
 class ElfParser;
 struct RelocBlock;
+struct RelocChunk;
 
 struct VersionInfo
 {
@@ -63,32 +68,76 @@ struct ElfImportRelocation
 typedef std::vector<ElfImportRelocation> Relocations;
 typedef std::map<std::string, Relocations> ImportLibs;
 
-struct RelocLocalValues
+/// Local reloc failed validation
+struct RelocDiagnostic
 {
-    uint16_t iE32Reloc;  // = (uint16_t)((r.iRela.r_offset & 0xfff) | relocType);
-    uint16_t iRelocType; // = rp->Fixup(r.iSymbol);
-    int      iPage;      // = r.iRela.r_offset & 0xfffff000;
-    std::string iSymbolName;
-    const char* iType = "unknown";
+    uint32_t    iPos       = 0; // index in LocalRelocs
+    Elf32_Addr  iOffset    = 0;
+    uint32_t    iSymNdx    = 0;
+    Elf32_Sym*  iSymbol    = nullptr;
+    uint16_t    iRelocType = 0; // = rp->Fixup(iSymbol);
+    const char* iType      = "unknown";
 };
 
-struct LocalReloc
+typedef std::map<std::string, std::vector<RelocDiagnostic> > BadRelocs;
+
+/// ELF relocation entry sorted out to import or local reloc
+struct ClassifiedReloc
 {
-    uint32_t	iSymNdx;
-    Elf32_Rela  iRela;
-    Elf32_Phdr* iSegment      = nullptr;
-    Elf32_Sym*  iSymbol       = nullptr;
-    bool        iHasRela      = false;
-    uint8_t	    iRelType      = 0;
-    bool        iDelSym       = false; // true for absent symbols only
-    bool        iVeneerSymbol = false;
-    /// TODO (Administrator#1#06/26/20): Use relocation types directly:
-    //      KReservedRelocType, KTextRelocType, KDataRelocType, KInferredRelocType
+    uint32_t    iEntry       = 0; // index in RelocBlock
+    bool        iImported    = false;
+    uint32_t    iSymNdx      = 0;
+    uint8_t     iRelType     = 0;
+    Elf32_Addr  iOffset      = 0;
+    // local relocs only
+    Elf32_Sym*  iSymbol      = nullptr;
     ESegmentType iSegmentType = ESegmentUndefined;
-    RelocLocalValues iIntermediates;
+    const Elf32_Phdr* iSegment = nullptr;
+    uint16_t    iRelocType   = 0; // = rp->Fixup(iSymbol);
+};
+
+/// Sorted relocs [iFirst, iFirst + iCount) of one 4 KB page
+struct RelocPage
+{
+    uint32_t iPage;
+    uint32_t iFirst;
+    uint32_t iCount;
 };
 
-typedef std::map<std::string, std::vector<LocalReloc> > BadRelocs;
+/// Local relocs of one segment as parallel arrays
+class LocalRelocs
+{
+    public:
+        /// segmentBase used if reloc has the lowest offset, see Base()
+        void Add(Elf32_Addr offset, uint16_t relocType, Elf32_Addr segmentBase, const char* srcname);
+        /// Attach diagnostic to the last added reloc
+        void AddDiagnostic(const RelocDiagnostic& d);
+        /// Index of offsets built on first call
+        bool Contains(Elf32_Addr offset);
+        /// Stable sort by offset, then Pages() valid
+        void Sort();
+
+        size_t Size() const;
+        Elf32_Addr Offset(size_t i) const;
+        uint16_t RelocType(size_t i) const;
+        const char* Source(size_t i) const;
+        Elf32_Addr Base() const;
+        /// Ordered by position
+        const std::vector<RelocDiagnostic>& Diagnostics() const;
+        const std::vector<RelocPage>& Pages() const;
+    private:
+        std::vector<Elf32_Addr> iOffsets;
+        std::vector<uint16_t> iRelocTypes;
+        std::vector<RelocDiagnostic> iDiagnostics;
+        std::vector<RelocPage> iPages;
+        Elf32_Addr iBase = 0;
+        Elf32_Addr iMinOffset = 0; // of relocs added so far, iBase taken from it
+        std::unordered_set<Elf32_Addr> iIndex;
+        bool iIndexed = false;
+#if EXPLORE_RELOCS_PROCESSING
+        std::vector<const char*> iSources;
+#endif // EXPLORE_RELOCS_PROCESSING
+};
 
 class RelocsProcessor
 {
@@ -104,24 +153,28 @@ class RelocsProcessor
         uint32_t ImportsCount() const;
         uint32_t DllCount() const;
         void ProcessVerInfo();
-        uint16_t Fixup(const Elf32_Sym* s);
-        void ValidateLocalReloc(const LocalReloc& r,
+        uint16_t Fixup(const Elf32_Sym* s) const;
+        void ValidateLocalReloc(const RelocDiagnostic& r,
                     const std::string& name);
+        bool HasCodeRelocation(Elf32_Addr offset);
 
     private:
         void RelocsFromSymbols();
         void ProcessSymbolInfo();
         void ProcessVeneers();
         void AddToImports(uint32_t index, Elf32_Rela rela);
+        void ProcessRelocations(const std::vector<RelocBlock>& blocks);
+        template <class T>
+        void ClassifyRelocations(const T* elfRel, RelocChunk& c) const;
         template <class T>
-        void ProcessRelocations(const T* elfRel, const RelocBlock& r);
-        void SortReloc(const LocalReloc& r);
+        void MergeRelocations(const T* elfRel, const RelocChunk& c);
+        void SortReloc(ESegmentType segmentType, Elf32_Addr offset, const Elf32_Phdr* segment,
+                uint32_t index, Elf32_Sym* sym, uint16_t relocType, const char* srcname);
         void SortRelocs();
-        void ApplyLocalReloc(const LocalReloc& rel);
+        void ApplyLocalReloc(Elf32_Addr offset, const Elf32_Sym* sym);
 
     private:
-        void AddToLocalRelocations(uint32_t index,
-                uint8_t relType, Elf32_Rela rela, const char* srcname);
+        void AddToLocalRelocations(const ClassifiedReloc& r, const char* srcname);
         void AddToLocalRelocations(uint32_t aAddr, uint32_t index,
                 uint8_t relType, Elf32_Sym* aSym,
                 const char* srcname, bool aDelSym = false,
@@ -130,8 +183,8 @@ class RelocsProcessor
     private:
         const ElfParser* iElf = nullptr;
         std::vector<VersionInfo> iVerInfo;
-        std::vector<LocalReloc> iCodeRelocations;
-        std::vector<LocalReloc> iDataRelocations;
+        LocalRelocs iCodeRelocations;
+        LocalRelocs iDataRelocations;
         const Symbols& iRelocSrc;
         ImportLibs iImports;
         uint16_t* iVersionTbl = nullptr;  //= iElf->VersionTbl();
@@ -0,0 +1,325 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Repack many E32Images in one process.
+//
+//
+
+#include <map>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "logger.h"
+#include "common.hpp"
+#include "profiler.h"
+#include "e32common.h"
+#include "repackrunner.h"
+#include "e32rebuilder.h"
+#include "elf2e32_opt.hpp"
+#include "workerpool.h"
+
+// images wait while others hold more memory, one image always allowed
+const size_t KRepackMemory = 512 * 1024 * 1024;
+
+RepackRunner::RepackRunner(const Args* args): iArgs(args) {}
+
+void RepackRunner::Run()
+{
+    ProfileScope scope("Repack");
+    FindImages();
+    iProfiler = Profiler::Current();
+
+    size_t workers = iArgs->iJobs;
+    if(!workers)
+        workers = std::thread::hardware_concurrency();
+    workers = std::max<size_t>(1, std::min(workers, iJobs.size()));
+    // pages of images packed by shared pool of the same size
+    SetWorkerThreads(iArgs->iJobs);
+
+    std::vector<std::thread> pool;
+    for(size_t i = 0; i < workers; i++)
+        pool.emplace_back(&RepackRunner::Worker, this);
+
+    // print results in order of files while workers go ahead
+    int failed = 0;
+    for(auto& job: iJobs)
+    {
+        {
+            std::unique_lock<std::mutex> lock(iMutex);
+            iFinished.wait(lock, [&job]{return job.iFinished;});
+        }
+        Logger::Instance()->Log(job.iMessages);
+        if(job.iStatus)
+        {
+            Logger::Instance()->Log(REPACKJOBFAILED, job.iInput, job.iStatus);
+            failed++;
+        }
+    }
+
+    for(auto& t: pool)
+        t.join();
+
+    PrintSummary();
+    ReportLog("Repack: %d images done, %d failed\n", (int)iJobs.size(), failed);
+    if(failed)
+        ReportError(REPACKFAILED, failed);
+}
+
+static bool IsDir(const std::string& path)
+{
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+}
+
+/// Create every missed directory of file path
+static void MakeDirs(const std::string& file)
+{
+    for(size_t pos = file.find_first_of("/\\", 1); pos != std::string::npos;
+        pos = file.find_first_of("/\\", pos + 1))
+    {
+        if(!MakeDir(file.substr(0, pos)))
+            ReportError(FILEOPENERROR, file.substr(0, pos));
+    }
+}
+
+/// Wildcards '*' for any characters and '?' for single one
+static bool MatchMask(const char* mask, const char* name)
+{
+    const char* star = nullptr;
+    const char* rest = nullptr;
+    while(*name)
+    {
+        if(*mask == '*')
+        {
+            star = mask++;
+            rest = name;
+        }
+        else if((*mask == '?') || (*mask == *name))
+        {
+            mask++;
+            name++;
+        }
+        else if(star)
+        {
+            mask = star + 1;
+            name = ++rest;
+        }
+        else
+            return false;
+    }
+    while(*mask == '*')
+        mask++;
+    return !*mask;
+}
+
+/// Files of dir matched by mask, subdirectories walked if recursive. Names relative to dir.
+static void ListFiles(const std::string& dir, const std::string& relative, const std::string& mask,
+                      bool recursive, std::vector<std::string>& files)
+{
+    DIR* d = opendir(dir.c_str());
+    if(!d)
+        ReportError(FILEOPENERROR, dir);
+    std::vector<std::string> names;
+    while(dirent* e = readdir(d))
+    {
+        std::string name = e->d_name;
+        if(name != "." && name != "..")
+            names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    for(auto& name: names)
+    {
+        std::string path = dir + "/" + name;
+        if(IsDir(path))
+        {
+            if(recursive)
+                ListFiles(path, relative + name + "/", mask, recursive, files);
+        }
+        else if(mask.empty() || MatchMask(mask.c_str(), name.c_str()))
+            files.push_back(relative + name);
+    }
+}
+
+/// Directory walked in full, mask looked up in own directory only
+void RepackRunner::FindImages()
+{
+    std::string dir = iArgs->iRepack, mask;
+    bool recursive = IsDir(dir);
+    if(!recursive)
+    {
+        size_t pos = dir.find_last_of("/\\");
+        mask = (pos == std::string::npos) ? dir : dir.substr(pos + 1);
+        dir = (pos == std::string::npos) ? "." : dir.substr(0, pos);
+    }
+    if(dir.size() > 1 && (dir.back() == '/' || dir.back() == '\\'))
+        dir.pop_back();
+
+    std::vector<std::string> files;
+    ListFiles(dir, "", mask, recursive, files);
+    for(auto& x: files)
+        AddImage(dir + "/" + x, x);
+
+    if(iJobs.empty())
+        ReportError(EMPTYREPACK, iArgs->iRepack);
+}
+
+/// Files without E32Image signature skipped, so directory may hold anything else
+void RepackRunner::AddImage(const std::string& file, const std::string& relative)
+{
+    char buf[sizeof(E32ImageHeader) + sizeof(E32ImageHeaderJ)] = {};
+    std::ifstream fs(file, std::ios::binary);
+    if(!fs.read(buf, sizeof(buf)))
+        return;
+    const E32ImageHeader* h = (const E32ImageHeader*)buf;
+    if(*(uint32_t*)(h->iSignature) != 0x434f5045) // 'EPOC'
+        return;
+
+    RepackJob job;
+    job.iInput = file;
+    job.iOutput = iArgs->iOutput.empty() ? file : iArgs->iOutput + "/" + relative;
+    job.iFrom = h->iCompressionType;
+    job.iTo = iArgs->iCompressionSet ? iArgs->iCompressionMethod : job.iFrom;
+    job.iSizeIn = GetFileStamp(file).iSize;
+
+    // input, decoded image and new one live at once
+    size_t unpacked = job.iSizeIn;
+    if(job.iFrom)
+        unpacked = h->iCodeOffset + ((const E32ImageHeaderJ*)(buf + sizeof(E32ImageHeader)))->iUncompressedSize;
+    job.iMemory = job.iSizeIn + 2 * unpacked;
+    iJobs.push_back(job);
+}
+
+/// Images taken by index, so fast workers pick up more of them
+void RepackRunner::Worker()
+{
+    for(;;)
+    {
+        size_t i = iNext++;
+        if(i >= iJobs.size())
+            return;
+
+        Acquire(iJobs[i].iMemory);
+        {
+            ProfileTrack track(iProfiler, i + 1, iJobs[i].iInput);
+            Repack(iJobs[i]);
+        }
+        Release(iJobs[i].iMemory);
+
+        std::lock_guard<std::mutex> lock(iMutex);
+        iJobs[i].iFinished = true;
+        iFinished.notify_one();
+    }
+}
+
+void RepackRunner::Acquire(size_t memory)
+{
+    std::unique_lock<std::mutex> lock(iMutex);
+    iMemoryFreed.wait(lock, [this, memory]{return !iInFlight || (iInFlight + memory <= KRepackMemory);});
+    iInFlight += memory;
+}
+
+void RepackRunner::Release(size_t memory)
+{
+    {
+        std::lock_guard<std::mutex> lock(iMutex);
+        iInFlight -= memory;
+    }
+    iMemoryFreed.notify_all();
+}
+
+/// E32Rebuilder writes temporary file renamed after validation,
+/// so output is either old file or complete new one.
+void RepackRunner::Repack(RepackJob& job)
+{
+    std::string tmp = TempFileName(job.iOutput);
+
+    Args args = *iArgs;
+    args.iRepack.clear();
+    args.iE32input = job.iInput;
+    args.iOutput = tmp;
+
+    Logger::CaptureOutput(&job.iMessages);
+    try{
+        MakeDirs(job.iOutput);
+        {
+            E32Rebuilder rebuilder(&args);
+            rebuilder.Run();
+        }
+        if(!RenameFile(tmp, job.iOutput))
+            ReportError(FILEOPENERROR, job.iOutput);
+        job.iSizeOut = GetFileStamp(job.iOutput).iSize;
+    }catch(ErrorCodes err){
+        job.iStatus = -err;
+    }catch(...){
+        job.iStatus = -ErrorCodes::UNKNOWNERROR;
+        ReportWarning(ErrorCodes::UNKNOWNERROR);
+    }
+    Logger::CaptureOutput(nullptr);
+    if(job.iStatus)
+        remove(tmp.c_str());
+}
+
+static const char* CompressionName(uint32_t compression)
+{
+    switch(compression)
+    {
+    case KFormatNotCompressed:
+        return "none";
+    case KUidCompressionDeflate:
+        return "inflate";
+    case KUidCompressionBytePair:
+        return "bytepair";
+    default:
+        return "unknown";
+    }
+}
+
+/// Sizes of repacked images grouped by compression before and after
+void RepackRunner::PrintSummary() const
+{
+    struct Totals
+    {
+        int iImages = 0;
+        int64_t iSizeIn = 0;
+        int64_t iSizeOut = 0;
+    };
+    std::map<std::pair<uint32_t, uint32_t>, Totals> totals;
+    for(auto& job: iJobs)
+    {
+        if(job.iStatus)
+            continue;
+        Totals& t = totals[std::make_pair(job.iFrom, job.iTo)];
+        t.iImages++;
+        t.iSizeIn += job.iSizeIn;
+        t.iSizeOut += job.iSizeOut;
+    }
+
+    for(auto& x: totals)
+    {
+        const Totals& t = x.second;
+        char ratio[16];
+        snprintf(ratio, sizeof(ratio), "%.1f%%", t.iSizeIn ? 100.0 * t.iSizeOut / t.iSizeIn : 100.0);
+        std::ostringstream os;
+        os << "Repack " << CompressionName(x.first.first) << " -> " << CompressionName(x.first.second)
+           << ": " << t.iImages << " images, " << t.iSizeIn << " -> " << t.iSizeOut
+           << " bytes (" << ratio << ")\n";
+        Logger::Instance()->Log(os.str());
+    }
+}
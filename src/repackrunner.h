@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Repack many E32Images in one process:
+//   elf2e32 --repack=<dir> [--output=<dir>] --compressionmethod=bytepair
+//   elf2e32 --repack=<dir>/*.dll ...
+// Directory searched recursively, mask matches files of its directory only.
+// Every image passed to E32Rebuilder with the rest options, results keep
+// paths relative to searched directory. Without --output inputs replaced.
+//
+//
+
+#ifndef REPACKRUNNER_H
+#define REPACKRUNNER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include "task.hpp"
+
+struct Args;
+class Profiler;
+
+struct RepackJob
+{
+    std::string iInput;
+    std::string iOutput;
+    uint32_t iFrom = 0; // compression of input
+    uint32_t iTo = 0; // compression of output
+    int64_t iSizeIn = 0;
+    int64_t iSizeOut = 0;
+    size_t iMemory = 0; // estimated peak memory while repacked
+    std::string iMessages; // captured messages
+    int iStatus = 0; // same as elf2e32 exit code
+    bool iFinished = false;
+};
+
+class RepackRunner : public Task
+{
+    public:
+        RepackRunner(const Args* args);
+        virtual ~RepackRunner() {}
+        virtual void Run() final override;
+    private:
+        void FindImages();
+        void AddImage(const std::string& file, const std::string& relative);
+        void Worker();
+        void Repack(RepackJob& job);
+        void Acquire(size_t memory);
+        void Release(size_t memory);
+        void PrintSummary() const;
+    private:
+        const Args* iArgs = nullptr;
+        std::vector<RepackJob> iJobs;
+        std::atomic<size_t> iNext{0};
+        std::mutex iMutex;
+        std::condition_variable iFinished;
+        std::condition_variable iMemoryFreed;
+        size_t iInFlight = 0; // memory of images in work
+        Profiler* iProfiler = nullptr; // of --repack run, images recorded as own tracks
+};
+
+#endif // REPACKRUNNER_H
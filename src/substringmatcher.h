@@ -0,0 +1,213 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Check that string is part of some word from fixed list, the same as
+//   strstr(list[0], s) || strstr(list[1], s) || ...
+// but in time linear to length of s.
+//
+// List compiled to suffix automaton at compile time. Every path from root
+// spells substring of some word, so lookup just follows transitions.
+// Empty string is part of every word. Automaton built twice: first to get
+// its size, then packed to matcher with exact size tables:
+//   constexpr size_t chars = WordsLength(list);
+//   constexpr AutomatonSize size = SubstringAutomaton<chars>(list).Size();
+//   static constexpr SubstringMatcher<chars, size.iStates, size.iEdges> matcher(list);
+//
+//
+
+#ifndef SUBSTRINGMATCHER_H
+#define SUBSTRINGMATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// Sum of word lengths, upper bound of matcher size
+template <size_t N>
+constexpr size_t WordsLength(const char* const (&words)[N])
+{
+    size_t length = 0;
+    for(size_t i = 0; i < N; i++)
+    {
+        for(const char* s = words[i]; *s; s++)
+            length++;
+    }
+    return length;
+}
+
+struct AutomatonSize
+{
+    size_t iStates;
+    size_t iEdges;
+};
+
+/// Suffix automaton for words with total length KChars, transitions kept in lists
+template <size_t KChars>
+class SubstringAutomaton
+{
+    template <size_t, size_t, size_t> friend class SubstringMatcher;
+    public:
+        template <size_t N>
+        constexpr SubstringAutomaton(const char* const (&words)[N])
+        {
+            iStates = 1;
+            iLink[0] = KNone;
+            iFirst[0] = KNone;
+            for(size_t i = 0; i < N; i++)
+            {
+                uint16_t last = 0;
+                for(const char* s = words[i]; *s; s++)
+                    last = Extend(last, *s);
+            }
+        }
+
+        constexpr AutomatonSize Size() const
+        {
+            return AutomatonSize{iStates, iEdges};
+        }
+
+    private:
+        // automaton has at most 2n states and 3n transitions
+        enum : size_t {KStates = 2 * KChars + 1, KEdges = 3 * KChars + 1};
+        static_assert(KEdges < 0xffff, "use wider index type");
+        enum : uint16_t {KNone = 0xffff};
+
+        constexpr uint16_t Next(uint16_t state, char c) const
+        {
+            for(uint16_t e = iFirst[state]; e != KNone; e = iEdgeNext[e])
+            {
+                if(iEdgeChar[e] == c)
+                    return iEdgeTo[e];
+            }
+            return KNone;
+        }
+
+        constexpr void SetNext(uint16_t state, char c, uint16_t to)
+        {
+            for(uint16_t e = iFirst[state]; e != KNone; e = iEdgeNext[e])
+            {
+                if(iEdgeChar[e] == c)
+                {
+                    iEdgeTo[e] = to;
+                    return;
+                }
+            }
+            iEdgeChar[iEdges] = c;
+            iEdgeTo[iEdges] = to;
+            iEdgeNext[iEdges] = iFirst[state];
+            iFirst[state] = iEdges++;
+        }
+
+        constexpr uint16_t NewState(uint16_t length)
+        {
+            iLength[iStates] = length;
+            iLink[iStates] = KNone;
+            iFirst[iStates] = KNone;
+            return iStates++;
+        }
+
+        /// Split q so that state reached from p by c has length len(p) + 1
+        constexpr uint16_t Clone(uint16_t p, char c, uint16_t q)
+        {
+            uint16_t clone = NewState(iLength[p] + 1);
+            for(uint16_t e = iFirst[q]; e != KNone; e = iEdgeNext[e])
+                SetNext(clone, iEdgeChar[e], iEdgeTo[e]);
+            iLink[clone] = iLink[q];
+            for(; (p != KNone) && (Next(p, c) == q); p = iLink[p])
+                SetNext(p, c, clone);
+            iLink[q] = clone;
+            return clone;
+        }
+
+        /// Add character to word ended at state last, words share automaton
+        constexpr uint16_t Extend(uint16_t last, char c)
+        {
+            uint16_t q = Next(last, c);
+            if(q != KNone)
+            {
+                if(iLength[last] + 1 == iLength[q])
+                    return q;
+                return Clone(last, c, q);
+            }
+
+            uint16_t cur = NewState(iLength[last] + 1);
+            uint16_t p = last;
+            for(; (p != KNone) && (Next(p, c) == KNone); p = iLink[p])
+                SetNext(p, c, cur);
+            if(p == KNone)
+                iLink[cur] = 0;
+            else
+            {
+                q = Next(p, c);
+                if(iLength[p] + 1 == iLength[q])
+                    iLink[cur] = q;
+                else
+                    iLink[cur] = Clone(p, c, q);
+            }
+            return cur;
+        }
+
+    private:
+        uint16_t iStates = 0;
+        uint16_t iEdges = 0;
+        uint16_t iLength[KStates] = {};
+        uint16_t iLink[KStates] = {};
+        uint16_t iFirst[KStates] = {};
+        char iEdgeChar[KEdges] = {};
+        uint16_t iEdgeTo[KEdges] = {};
+        uint16_t iEdgeNext[KEdges] = {};
+};
+
+/// Automaton packed to arrays: transitions of state i are iChar[iFirst[i]..iFirst[i + 1]]
+template <size_t KChars, size_t KStates, size_t KEdges>
+class SubstringMatcher
+{
+    public:
+        template <size_t N>
+        constexpr SubstringMatcher(const char* const (&words)[N])
+        {
+            SubstringAutomaton<KChars> a(words);
+            uint16_t edge = 0;
+            for(size_t i = 0; i < KStates; i++)
+            {
+                iFirst[i] = edge;
+                for(uint16_t e = a.iFirst[i]; e != a.KNone; e = a.iEdgeNext[e])
+                {
+                    iChar[edge] = a.iEdgeChar[e];
+                    iTo[edge++] = a.iEdgeTo[e];
+                }
+            }
+            iFirst[KStates] = edge;
+        }
+
+        constexpr bool Contains(const char* s) const
+        {
+            size_t state = 0;
+            for(; *s; s++)
+            {
+                size_t e = iFirst[state];
+                while((e < iFirst[state + 1]) && (iChar[e] != *s))
+                    e++;
+                if(e == iFirst[state + 1])
+                    return false;
+                state = iTo[e];
+            }
+            return true;
+        }
+
+    private:
+        uint16_t iFirst[KStates + 1] = {};
+        char iChar[KEdges] = {};
+        uint16_t iTo[KEdges] = {};
+};
+
+#endif // SUBSTRINGMATCHER_H
@@ -17,57 +17,45 @@
 #include <iostream>
 #include "symbol.h"
 #include "common.hpp"
+#include "symboltable.h"
 
 using namespace std;
 
-Elf32_Sym* Dup(const Elf32_Sym* symbol)
-{
-    Elf32_Sym* tmp = new Elf32_Sym();
-    tmp->st_name = symbol->st_name;
-    tmp->st_value = symbol->st_value;
-    tmp->st_size = symbol->st_size;
-    tmp->st_info = symbol->st_info;
-    tmp->st_other = symbol->st_other;
-    tmp->st_shndx = symbol->st_shndx;
-    return tmp;
-}
-
-Symbol::Symbol(SymbolType stype): iSymbolType(stype) {}
+Symbol::Symbol(SymbolArena* arena, SymbolType stype): iArena(arena), iSymbolType(stype) {}
 
-Symbol::Symbol(const std::string& symbolName, SymbolType type,
+Symbol::Symbol(SymbolArena* arena, const std::string& symbolName, SymbolType type,
    const Elf32_Sym* symbol, uint32_t ordinal):
-   iSymbolName(symbolName), iSymbolType(type), iOrdinal(ordinal)
+   iArena(arena), iSymbolName(arena->Intern(symbolName)), iSymbolType(type), iOrdinal(ordinal)
 {
-    iElfSym = Dup(symbol);
+    SetElfSymbol(symbol);
 }
 
-Symbol::~Symbol()
-{
-    delete iElfSym;
-}
+/// Copy to other arena
+Symbol::Symbol(SymbolArena* arena, const Symbol& s):
+    iArena(arena), iElfSym(s.iElfSym), iHasElfSym(s.iHasElfSym),
+    iSymbolStatus(s.iSymbolStatus), iSymbolName(arena->Intern(s.iSymbolName)),
+    iAliasName(arena->Intern(s.iAliasName)), iSymbolType(s.iSymbolType), iOrdinal(s.iOrdinal),
+    iComment(arena->Intern(s.iComment)), iAbsent(s.iAbsent), iR3Unused(s.iR3Unused), iSize(s.iSize)
+{}
 
 void Symbol::SetElfSymbol(const Elf32_Sym* symbol)
 {
-    if(iElfSym)
-    {
-        delete iElfSym;
-        iElfSym = nullptr;
-    }
-    iElfSym = Dup(symbol);
+    iElfSym = *symbol;
+    iHasElfSym = true;
 }
 
 uint32_t Symbol::Elf_st_value() const
 {
-    return iElfSym->st_value;
+    return iElfSym.st_value;
 }
 
 Elf32_Sym* Symbol::GetElf32_Sym() const
 {
-    return iElfSym;
+    return iHasElfSym ? const_cast<Elf32_Sym*>(&iElfSym) : nullptr;
 }
 
 bool Symbol::operator==(const Symbol* s) const {
-	if(this->iSymbolName.compare(s->iSymbolName) != 0)
+	if(strcmp(this->iSymbolName, s->iSymbolName) != 0)
 		return false;
 	if(this->iSymbolType != s->iSymbolType)
 		return false;
@@ -82,7 +70,7 @@ bool Symbol::operator!=(const Symbol* s) const
 
 
 void Symbol::SetName(const std::string& s){
-    iSymbolName = s;
+    iSymbolName = iArena->Intern(s);
 }
 
 std::string Symbol::Name() const {
@@ -133,7 +121,7 @@ std::string Symbol::DefFileComment() const {
 
 ///This function sets the comment in .def file against the symbol.
 void Symbol::SetDefFileComment(const std::string& s) {
-	iComment = s;
+	iComment = iArena->Intern(s);
 }
 
 
@@ -152,7 +140,11 @@ void Symbol::SetSymbolStatus(SymbolStatus status) {
 
 // use this function if doesn't sure
 std::string Symbol::AliasName() const {
-    if(iAliasName.empty())
+    return AliasNameCStr();
+}
+
+const char* Symbol::AliasNameCStr() const {
+    if(!*iAliasName)
         return iSymbolName;
     return iAliasName;
 }
@@ -168,7 +160,7 @@ void Symbol::SetAliasName(const std::string& alias) {
     ReportLog("which has alias name. Please\n");
     ReportLog("open issue at https://github.com/fedor4ever/elf2e32_next\n");
     ReportLog("and give me that file. Thanks.");
-	iAliasName = alias;
+	iAliasName = iArena->Intern(alias);
 }
 
 uint32_t Symbol::SymbolSize() const {
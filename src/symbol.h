@@ -17,12 +17,15 @@
 //   AliasName() - symbol name used in exports symbol table
 //   RawAliasName() - alias for symbol name used in .def file
 // Therefore use AliasName() where possible.
+// AliasNameCStr() - same as AliasName() without copy
 //
 // This class provides 2 functions to set symbol name:
 //   SetName() - implicitly set alias name too
 //   SetAliasName() - directly set alias name
 // Therefore use SetName() where possible.
 //
+// Symbols created by SymbolArena only, names stored there.
+//
 
 #if !defined(SYMBOL_H)
 #define SYMBOL_H
@@ -31,10 +34,11 @@
 #include "elfdefs.h"
 
 struct Elf32_Sym;
+class SymbolArena;
 
 enum SymbolStatus {Matching, Missing, New};
 
-enum SymbolType
+enum SymbolType : int
 {
 	SymbolTypeNotDefined = STT_NOTYPE,
 	SymbolTypeData = STT_OBJECT,
@@ -43,12 +47,16 @@ enum SymbolType
 
 class Symbol
 {
+    friend class SymbolArena;
+    Symbol(SymbolArena* arena, SymbolType type);
+    Symbol(SymbolArena* arena, const std::string& symbolName, SymbolType type,
+           const Elf32_Sym* symbol, uint32_t ordinal);
+    Symbol(SymbolArena* arena, const Symbol& s);
 
 public:
 
-    Symbol(SymbolType type);
-    Symbol(const std::string& symbolName, SymbolType type, const Elf32_Sym* symbol, uint32_t ordinal);
-	~Symbol();
+    Symbol(const Symbol& s) = delete;
+    Symbol& operator=(const Symbol&) = delete;
 
 	bool operator==(const Symbol* aSym) const;
 	bool operator!=(const Symbol* aSym) const;
@@ -63,6 +71,7 @@ public:
 	void SetName(const std::string& symbolName);
 
 	std::string AliasName() const;
+	const char* AliasNameCStr() const;
 	std::string RawAliasName() const;
 	void SetAliasName(const std::string& symbolName);
 
@@ -85,14 +94,16 @@ public:
 	Elf32_Sym* GetElf32_Sym() const;
 	uint32_t Elf_st_value() const;
 private:
-    Elf32_Sym* iElfSym = nullptr;
+    SymbolArena*    iArena = nullptr;
+    Elf32_Sym       iElfSym = {};
+    bool            iHasElfSym = false;
 
 	SymbolStatus    iSymbolStatus = SymbolStatus::Missing;
-	std::string		iSymbolName;
-	std::string		iAliasName;
+	const char*		iSymbolName = "";
+	const char*		iAliasName = "";
 	SymbolType	    iSymbolType = SymbolTypeNotDefined;
 	uint32_t	    iOrdinal  = -1;
-	std::string		iComment;
+	const char*		iComment = "";
 	bool		    iAbsent = false;
 	bool		    iR3Unused = false;
 	uint32_t	    iSize = 0;
@@ -43,7 +43,7 @@ void SymbolLookupSection::ProcessSymbols()
         iSymNameOffset = iSymbolNames.size() >> 2;
 		iSymNameOffTab.push_back(iSymNameOffset);
 
-		iSymbolNames += x->AliasName();
+		iSymbolNames += x->AliasNameCStr();
 		iSymbolNames += '\0';
 
 		uint32_t align = Align(iSymbolNames.size());
@@ -17,7 +17,10 @@
 
 #include <memory>
 #include <string.h>
+#include <vector>
+#include <iterator>
 #include <algorithm>
+#include <unordered_map>
 
 #include "symbol.h"
 #include "deffile.h"
@@ -25,6 +28,7 @@
 #include "elf2e32_opt.hpp"
 #include "symbolprocessor.h"
 #include "staticlibsymbols.h"
+#include "substringmatcher.h"
 
 using std::list;
 using std::string;
@@ -46,10 +50,62 @@ SymbolProcessor::~SymbolProcessor()
     //dtor
 }
 
-bool SortSymbolsByName(const Symbol* first, const Symbol* second){ return first->AliasName() < second->AliasName();}
+bool SortSymbolsByName(const Symbol* first, const Symbol* second)
+{
+    return strcmp(first->AliasNameCStr(), second->AliasNameCStr()) < 0;
+}
 bool SortSymbolsByOrdinal(const Symbol* first, const Symbol* second){ return first->Ordinal() < second->Ordinal();}
 
-typedef Symbols::iterator Iterator;
+/// Name and ordinal indexes of symbols merged from .def file and --sysdef.
+/// Symbols only appended, so position in list is stable. Several symbols may share
+/// ordinal after reassignment, then one with the last position wins as for list search.
+class MergeIndex
+{
+    public:
+        MergeIndex(const Symbols& symbols)
+        {
+            iSymbols.reserve(symbols.size());
+            for(auto x: symbols)
+                Add(x);
+        }
+        void Add(Symbol* s)
+        {
+            size_t pos = iSymbols.size();
+            iSymbols.push_back(s);
+            iNames[s->AliasName()] = pos;
+            iOrdinals[s->Ordinal()].push_back(pos);
+        }
+        size_t FindName(const string& name) const
+        {
+            auto it = iNames.find(name);
+            if(it == iNames.end())
+                return npos;
+            return it->second;
+        }
+        size_t FindOrdinal(uint32_t ordinal) const
+        {
+            auto it = iOrdinals.find(ordinal);
+            if((it == iOrdinals.end()) || it->second.empty())
+                return npos;
+            return *std::max_element(it->second.begin(), it->second.end());
+        }
+        void SetOrdinal(size_t pos, uint32_t ordinal)
+        {
+            std::vector<size_t>& old = iOrdinals[iSymbols[pos]->Ordinal()];
+            old.erase(std::find(old.begin(), old.end(), pos));
+            iSymbols[pos]->SetOrdinal(ordinal);
+            iOrdinals[ordinal].push_back(pos);
+        }
+        void SetNew(size_t pos) { iSymbols[pos]->SetSymbolStatus(SymbolStatus::New); }
+        size_t Last() const { return iSymbols.size() - 1; }
+    public:
+        static const size_t npos = (size_t)-1;
+    private:
+        std::vector<Symbol*> iSymbols;
+        std::unordered_map<string, size_t> iNames;
+        std::unordered_map<uint32_t, std::vector<size_t> > iOrdinals;
+};
+
 void SymbolProcessor::ProcessPredefinedSymbols()
 {
     if(iArgs->iDefinput.empty() && iArgs->iSysdef.empty())
@@ -76,62 +132,45 @@ void SymbolProcessor::ProcessPredefinedSymbols()
         lastOrdinal = (*sysDefSym.crbegin())->Ordinal();
     lastOrdinal++;
 
-    Iterator nameIt = iSymbols.end(), ordIt = iSymbols.end(), lastIt = iSymbols.end();
-    bool eqSymbols = false;
+    MergeIndex index(iSymbols);
     for(auto x: sysDefSym)
     {
-        nameIt = iSymbols.end(), ordIt = iSymbols.end(), lastIt = iSymbols.end();
-        for(auto y = iSymbols.begin(); y != lastIt; y++)
-        {
-            if(*y == x)
-            {
-                eqSymbols = true;
-                break;
-            }
-            if( (*y)->Ordinal() == x->Ordinal())
-                ordIt = y;
-            if( (*y)->AliasName() == x->AliasName())
-                nameIt = y;
-        }
+        size_t namePos = index.FindName(x->AliasName());
+        size_t ordPos = index.FindOrdinal(x->Ordinal());
 
-        if(eqSymbols)
+        if(namePos == index.Last())
         {
-            eqSymbols = false;
+            index.SetOrdinal(namePos, x->Ordinal());
             continue;
         }
 
-        if(*iSymbols.crbegin() == x)
-            continue;
-
-        if( (*iSymbols.crbegin())->AliasName() == x->AliasName() )
+        else if( (namePos == MergeIndex::npos) && (ordPos == MergeIndex::npos) )
         {
-            (*iSymbols.crbegin())->SetOrdinal(x->Ordinal());
-            continue;
-        }
-
-        else if( (nameIt == ordIt) && (nameIt == lastIt) )
             iSymbols.push_back(x);
+            index.Add(x);
+        }
 
-        else if((nameIt != ordIt) && (x != *lastIt))
+        else if(namePos != ordPos)
         {
-            if(nameIt == lastIt)
+            if(namePos == MergeIndex::npos)
             {
-                (*ordIt)->SetOrdinal(lastOrdinal);
-                (*ordIt)->SetSymbolStatus(SymbolStatus::New);
+                index.SetOrdinal(ordPos, lastOrdinal);
+                index.SetNew(ordPos);
                 iSymbols.push_back(x);
+                index.Add(x);
             }
-            else if(ordIt == lastIt) //simple set new ordinal
+            else if(ordPos == MergeIndex::npos) //simple set new ordinal
             {
-                (*nameIt)->SetOrdinal(x->Ordinal());
-                (*nameIt)->SetSymbolStatus(SymbolStatus::New);
+                index.SetOrdinal(namePos, x->Ordinal());
+                index.SetNew(namePos);
             }
             else
             {
-                (*nameIt)->SetOrdinal(x->Ordinal());
-                (*nameIt)->SetSymbolStatus(SymbolStatus::New);
+                index.SetOrdinal(namePos, x->Ordinal());
+                index.SetNew(namePos);
 
-                (*ordIt)->SetOrdinal(lastOrdinal);
-                (*ordIt)->SetSymbolStatus(SymbolStatus::New);
+                index.SetOrdinal(ordPos, lastOrdinal);
+                index.SetNew(ordPos);
             }
             lastOrdinal++;
         }
@@ -158,7 +197,7 @@ bool SymbolProcessor::SimpleSymbolsProcessing()
     if(iArgs->iDefinput.empty() && iArgs->iSysdef.empty())
     {
         iSymbols = GetElfExports();
-        iSymbols.sort(SortSymbolsByName);
+        std::stable_sort(iSymbols.begin(), iSymbols.end(), SortSymbolsByName);
         uint32_t ord = 1;
         for(auto x: iSymbols)
         {
@@ -188,17 +227,17 @@ void SymbolProcessor::ProcessElfSymbols()
     Symbols elfSym = GetElfExports();
     //look for absent symbols and add them
     Symbols absentSymbols, newsymbols;
-    iSymbols.sort(SortSymbolsByOrdinal);
+    std::stable_sort(iSymbols.begin(), iSymbols.end(), SortSymbolsByOrdinal);
     uint32_t lastOrdinal = (*iSymbols.crbegin())->Ordinal();
     lastOrdinal++;
 
-    iSymbols.sort(SortSymbolsByName);
+    std::stable_sort(iSymbols.begin(), iSymbols.end(), SortSymbolsByName);
 
     std::set_difference(iSymbols.begin(), iSymbols.end(), elfSym.begin(), elfSym.end(),
-            std::inserter(absentSymbols, absentSymbols.begin()), SortSymbolsByName);
+            std::back_inserter(absentSymbols), SortSymbolsByName);
 
     std::set_difference(elfSym.begin(), elfSym.end(), iSymbols.begin(), iSymbols.end(),
-            std::inserter(newsymbols, newsymbols.begin()), SortSymbolsByName);
+            std::back_inserter(newsymbols), SortSymbolsByName);
 
     // dealing with new symbols
     std::list<string> ls;
@@ -257,7 +296,8 @@ void SymbolProcessor::ProcessElfSymbols()
     MapAbsentWithElfSymbols(elfSym);
     CheckForErrors(iArgs->iUnfrozen, ls, iArgs->iElfinput);
     ls.clear();
-    iSymbols.merge(filtered);
+    // order doesn't matter, GetExports() sorts by ordinal
+    iSymbols.insert(iSymbols.end(), filtered.begin(), filtered.end());
 }
 
 void SymbolProcessor::CheckForErrors(bool unfrozen, list<string> missedSymbols, const string& src)
@@ -280,7 +320,7 @@ void SymbolProcessor::CheckForErrors(bool unfrozen, list<string> missedSymbols,
         {
             if(!iArgs->iDefoutput.empty())
             {
-                iSymbols.sort(SortSymbolsByOrdinal);
+                std::stable_sort(iSymbols.begin(), iSymbols.end(), SortSymbolsByOrdinal);
                 DefFile def;
                 def.WriteDefFile(iArgs->iDefoutput.c_str(), iSymbols);
             }
@@ -302,11 +342,12 @@ void SymbolProcessor::MapAbsentWithElfSymbols(const Symbols& fromElf)
 
     while((it1 != iSymbols.end()) && (it2 != fromElf.end()))
     {
-        if((*it1)->AliasName() > (*it2)->AliasName())
+        int cmp = strcmp((*it1)->AliasNameCStr(), (*it2)->AliasNameCStr());
+        if(cmp > 0)
             it2++;
-        else if((*it1)->AliasName() < (*it2)->AliasName())
+        else if(cmp < 0)
             it1++;
-        else if((*it1)->AliasName() == (*it2)->AliasName())
+        else
         {
             (*it1)->SetElfSymbol( (*it2)->GetElf32_Sym());
             if( (*it1)->Absent() )
@@ -348,7 +389,7 @@ Symbols SymbolProcessor::GetExports()
 
     ProcessPredefinedSymbols();
     ProcessElfSymbols();
-    iSymbols.sort(SortSymbolsByOrdinal);
+    std::stable_sort(iSymbols.begin(), iSymbols.end(), SortSymbolsByOrdinal);
     return iSymbols;
 }
 
@@ -368,7 +409,7 @@ Symbols SymbolProcessor::GetDSOSymbols()
             continue;
 
         SymbolType type = SymbolTypeCodeOrData(symTableEntity);
-        Symbol* sym = new Symbol(symName, type, symTableEntity, ordinals[i - 1]);
+        Symbol* sym = NewSymbol(symName, type, symTableEntity, ordinals[i - 1]);
         sym->SetSymbolSize(symTableEntity->st_size);
         sym->SetSymbolStatus(SymbolStatus::Matching);
         if(sym->AliasName().find("_._.absent_export_") != string::npos)
@@ -396,12 +437,12 @@ Symbols SymbolProcessor::GetElfExports()
             continue;
 
         SymbolType type = SymbolTypeCodeOrData(symTableEntity);
-        Symbol* sym = new Symbol(symName, type, symTableEntity, i);
+        Symbol* sym = NewSymbol(symName, type, symTableEntity, i);
         sym->SetSymbolSize(symTableEntity->st_size);
         sym->SetSymbolStatus(SymbolStatus::New);
         elf.push_back(sym);
     }
-    elf.sort(SortSymbolsByName);
+    std::stable_sort(elf.begin(), elf.end(), SortSymbolsByName);
 
     if(elf.empty() && (iArgs->iTargettype != TargetType::EStdExe))
         ReportError(ErrorCodes::ZEROBUFFER, "DLL Elf file has no exports! Check symbol(s) visibility!");
@@ -459,13 +500,13 @@ Symbols SymbolProcessor::FromSysdef()
             ReportLog(msg);
             continue;
         }
-        Symbol* s = new Symbol(SymbolType::SymbolTypeCode);
+        Symbol* s = NewSymbol(SymbolType::SymbolTypeCode);
         s->SetName(funcname);
         s->SetOrdinal(ordinalnum);
         s->SetSymbolStatus(SymbolStatus::New);
         sysdef.push_back(s);
     }
-    sysdef.sort(SortSymbolsByOrdinal);
+    std::stable_sort(sysdef.begin(), sysdef.end(), SortSymbolsByOrdinal);
     return sysdef;
 }
 
@@ -552,17 +593,17 @@ bool UnCallableSymbol(const string& s)
 /**
 Function checks if new symbols are present in the static library list
 */
+constexpr size_t KUnwantedChars = WordsLength(Unwantedruntimesymbols);
+constexpr AutomatonSize KUnwantedSize = SubstringAutomaton<KUnwantedChars>(Unwantedruntimesymbols).Size();
+static constexpr SubstringMatcher<KUnwantedChars, KUnwantedSize.iStates, KUnwantedSize.iEdges>
+    UnwantedMatcher(Unwantedruntimesymbols);
+
+/// Symbol is part of some name from Unwantedruntimesymbols
 bool UnWantedSymbol(const char* aSymbol)
 {
-	constexpr size_t symbollistsize = sizeof(Unwantedruntimesymbols) / sizeof(Unwantedruntimesymbols[0]);
-	for (size_t i = 0; i<symbollistsize; i++)
-	{
-		if (strstr(Unwantedruntimesymbols[i], aSymbol))
-        {
-            ReportLog("Unwantedruntimesymbol: ");
-            ReportLog(aSymbol);
-			return true;
-        }
-	}
-	return false;
+    if(!UnwantedMatcher.Contains(aSymbol))
+        return false;
+    ReportLog("Unwantedruntimesymbol: ");
+    ReportLog(aSymbol);
+    return true;
 }
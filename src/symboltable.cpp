@@ -0,0 +1,149 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Arena for symbols and their names.
+//
+//
+
+#include <new>
+#include <string.h>
+#include <type_traits>
+
+#include "symbol.h"
+#include "common.hpp"
+#include "symboltable.h"
+
+const size_t KSymbolsInBlock = 1024;
+const size_t KCharsInBlock = 64 * 1024;
+
+// arena releases memory without destructors
+static_assert(std::is_trivially_destructible<Symbol>::value, "Symbol should not own memory");
+
+static thread_local SymbolArena* CurrentArena = nullptr;
+
+SymbolArena::~SymbolArena()
+{
+    if(iAttached)
+        CurrentArena = iPrev;
+    for(auto x: iBlocks)
+        ::operator delete(x);
+    for(auto x: iChars)
+        delete[] x;
+}
+
+void SymbolArena::Attach()
+{
+    iPrev = CurrentArena;
+    CurrentArena = this;
+    iAttached = true;
+}
+
+/// No fallback arena: symbols made on worker threads of --batch and --serve
+/// would live until process ends.
+SymbolArena* SymbolArena::Current()
+{
+    if(!CurrentArena)
+        ReportError(NOSYMBOLARENA);
+    return CurrentArena;
+}
+
+void* SymbolArena::AllocateSymbol()
+{
+    if(iBlocks.empty() || (iBlockUsed == KSymbolsInBlock))
+    {
+        iBlocks.push_back(::operator new(KSymbolsInBlock * sizeof(Symbol)));
+        iBlockUsed = 0;
+    }
+    return (Symbol*)iBlocks.back() + iBlockUsed++;
+}
+
+Symbol* SymbolArena::New(SymbolType type)
+{
+    return new(AllocateSymbol()) Symbol(this, type);
+}
+
+Symbol* SymbolArena::New(const std::string& name, SymbolType type, const Elf32_Sym* sym, uint32_t ordinal)
+{
+    return new(AllocateSymbol()) Symbol(this, name, type, sym, ordinal);
+}
+
+Symbol* SymbolArena::Copy(const Symbol* s)
+{
+    return new(AllocateSymbol()) Symbol(this, *s);
+}
+
+const char* SymbolArena::Intern(const std::string& s)
+{
+    return Intern(s.c_str());
+}
+
+const char* SymbolArena::Intern(const char* s)
+{
+    if(!*s)
+        return "";
+    auto it = iNames.find(s);
+    if(it != iNames.end())
+        return *it;
+
+    size_t size = strlen(s) + 1;
+    char* str = nullptr;
+    if(size > KCharsInBlock / 4) // don't waste rest of block
+    {
+        str = new char[size];
+        iChars.push_back(str);
+    }
+    else
+    {
+        if(size > iCharLeft)
+        {
+            iCharPos = new char[KCharsInBlock];
+            iCharLeft = KCharsInBlock;
+            iChars.push_back(iCharPos);
+        }
+        str = iCharPos;
+        iCharPos += size;
+        iCharLeft -= size;
+    }
+    memcpy(str, s, size);
+    iNames.insert(str);
+    return str;
+}
+
+/// FNV-1a
+size_t SymbolArena::Hash::operator()(const char* s) const
+{
+    uint32_t h = 2166136261u;
+    for(; *s; s++)
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    return h;
+}
+
+bool SymbolArena::Equal::operator()(const char* a, const char* b) const
+{
+    return strcmp(a, b) == 0;
+}
+
+Symbol* NewSymbol(SymbolType type)
+{
+    return SymbolArena::Current()->New(type);
+}
+
+Symbol* NewSymbol(const std::string& name, SymbolType type, const Elf32_Sym* sym, uint32_t ordinal)
+{
+    return SymbolArena::Current()->New(name, type, sym, ordinal);
+}
+
+Symbol* CopySymbol(const Symbol* s)
+{
+    return SymbolArena::Current()->Copy(s);
+}
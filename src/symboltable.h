@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Symbols table shared by SymbolProcessor, DefFile, DSOFile and E32File.
+//
+// Symbol objects placed in blocks of SymbolArena, their names interned in
+// the same arena: ELF and DEF symbol with equal name share one string.
+// Arena frees everything at once, so Symbols is plain vector of pointers
+// and cheap to copy, sort and walk.
+//
+// Elf2E32 attaches arena to thread for every job, NewSymbol() allocates
+// there. Symbol created without attached arena is an error.
+//
+//
+
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+
+class Symbol;
+struct Elf32_Sym;
+enum SymbolType : int;
+
+typedef std::vector<Symbol*> Symbols;
+
+class SymbolArena
+{
+    public:
+        SymbolArena() {}
+        SymbolArena(const SymbolArena&) = delete;
+        SymbolArena& operator=(const SymbolArena&) = delete;
+        ~SymbolArena();
+
+        Symbol* New(SymbolType type);
+        Symbol* New(const std::string& name, SymbolType type, const Elf32_Sym* sym, uint32_t ordinal);
+        Symbol* Copy(const Symbol* s);
+        /// Equal strings share storage, valid while arena lives
+        const char* Intern(const char* s);
+        const char* Intern(const std::string& s);
+
+        /// NewSymbol() allocates in this arena on calling thread until destruction
+        void Attach();
+        /// Arena attached to calling thread, error if none
+        static SymbolArena* Current();
+    private:
+        void* AllocateSymbol();
+    private:
+        struct Hash
+        {
+            size_t operator()(const char* s) const;
+        };
+        struct Equal
+        {
+            bool operator()(const char* a, const char* b) const;
+        };
+    private:
+        std::vector<void*> iBlocks;
+        size_t iBlockUsed = 0;
+        std::vector<char*> iChars;
+        char* iCharPos = nullptr;
+        size_t iCharLeft = 0;
+        std::unordered_set<const char*, Hash, Equal> iNames;
+        bool iAttached = false;
+        SymbolArena* iPrev = nullptr;
+};
+
+Symbol* NewSymbol(SymbolType type);
+Symbol* NewSymbol(const std::string& name, SymbolType type, const Elf32_Sym* sym, uint32_t ordinal);
+Symbol* CopySymbol(const Symbol* s);
+
+#endif // SYMBOLTABLE_H
@@ -0,0 +1,158 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Threads shared by whole process for work split inside single build.
+//
+// Job lives on stack of ParallelFor() and queued while it has items left.
+// Pool thread counts itself as user of job while it takes items, caller
+// waits for all items done and no users left before job goes away.
+//
+//
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <condition_variable>
+
+#include "workerpool.h"
+
+struct ParallelJob
+{
+    uint32_t iCount = 0;
+    const std::function<void(uint32_t)>* iTask = nullptr;
+    std::atomic<uint32_t> iNext{0};
+    // guarded by WorkerPool::iLock
+    uint32_t iDone = 0;
+    uint32_t iUsers = 0;
+    std::exception_ptr iError;
+    std::condition_variable iFinished;
+};
+
+struct WorkerPool
+{
+    std::mutex iLock;
+    std::condition_variable iHasWork;
+    std::deque<ParallelJob*> iQueue;
+};
+
+static std::atomic<uint32_t> WorkerThreads{0};
+static std::once_flag PoolStarted;
+
+/// Never destroyed: pool threads still wait on it while process exits
+static WorkerPool& Pool()
+{
+    static WorkerPool* pool = new WorkerPool();
+    return *pool;
+}
+
+void SetWorkerThreads(uint32_t threads)
+{
+    WorkerThreads = threads;
+}
+
+static uint32_t PoolSize()
+{
+    uint32_t threads = WorkerThreads;
+    if(!threads)
+        threads = std::thread::hardware_concurrency();
+    return std::max<uint32_t>(1, threads);
+}
+
+/// Items taken until job has none left, then result counted under lock
+static void RunItems(ParallelJob& job, bool user)
+{
+    uint32_t done = 0;
+    std::exception_ptr error;
+    for(uint32_t i = job.iNext++; i < job.iCount; i = job.iNext++)
+    {
+        try{
+            (*job.iTask)(i);
+        }catch(...){
+            if(!error)
+                error = std::current_exception();
+        }
+        done++;
+    }
+
+    WorkerPool& pool = Pool();
+    std::lock_guard<std::mutex> lock(pool.iLock);
+    if(error && !job.iError)
+        job.iError = error;
+    job.iDone += done;
+    if(user)
+        job.iUsers--;
+    if((job.iDone == job.iCount) && !job.iUsers)
+        job.iFinished.notify_all();
+}
+
+static void PoolThread()
+{
+    WorkerPool& pool = Pool();
+    for(;;)
+    {
+        ParallelJob* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(pool.iLock);
+            pool.iHasWork.wait(lock, [&pool]{return !pool.iQueue.empty();});
+            job = pool.iQueue.front();
+            if(job->iNext >= job->iCount)
+            {
+                pool.iQueue.pop_front(); // every item taken, go to next job
+                continue;
+            }
+            job->iUsers++;
+        }
+        RunItems(*job, true);
+    }
+}
+
+static void StartPool()
+{
+    for(uint32_t i = 1; i < PoolSize(); i++)
+        std::thread(PoolThread).detach();
+}
+
+void ParallelFor(uint32_t count, uint32_t minParallel, const std::function<void(uint32_t)>& task)
+{
+    if((count < std::max<uint32_t>(minParallel, 2)) || (PoolSize() < 2))
+    {
+        for(uint32_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+    std::call_once(PoolStarted, StartPool);
+
+    ParallelJob job;
+    job.iCount = count;
+    job.iTask = &task;
+    WorkerPool& pool = Pool();
+    {
+        std::lock_guard<std::mutex> lock(pool.iLock);
+        pool.iQueue.push_back(&job);
+    }
+    pool.iHasWork.notify_all();
+
+    RunItems(job, false);
+    {
+        std::unique_lock<std::mutex> lock(pool.iLock);
+        job.iFinished.wait(lock, [&job]{return (job.iDone == job.iCount) && !job.iUsers;});
+        auto it = std::find(pool.iQueue.begin(), pool.iQueue.end(), &job);
+        if(it != pool.iQueue.end())
+            pool.iQueue.erase(it);
+    }
+    if(job.iError)
+        std::rethrow_exception(job.iError);
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2024 Strizhniou Fiodar
+// All rights reserved.
+// This component and the accompanying materials are made available
+// under the terms of "Eclipse Public License v1.0"
+// which accompanies this distribution, and is available
+// at the URL "http://www.eclipse.org/legal/epl-v10.html".
+//
+// Initial Contributors:
+// Strizhniou Fiodar - initial contribution.
+//
+// Contributors:
+//
+// Description:
+// Threads shared by whole process for work split inside single build:
+// bytepair pages, relocation chunks. Pool started on first use and
+// never grows, so --batch and --repack workers queue their items to the
+// same threads instead of starting own ones, and thread_local work
+// buffers of compressor survive between images.
+//
+//
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <cstdint>
+#include <functional>
+
+/// Threads count of pool including caller, 0 for all cores. Taken from --jobs
+/// of --batch and --repack, has effect only before first ParallelFor().
+void SetWorkerThreads(uint32_t threads);
+
+/// Call task(i) for every i below count and return when all of them done.
+/// Caller takes items too, so nested and concurrent calls progress while
+/// pool busy. Less than minParallel items run on caller alone.
+/// First exception of task rethrown in caller.
+void ParallelFor(uint32_t count, uint32_t minParallel, const std::function<void(uint32_t)>& task);
+
+#endif // WORKERPOOL_H